@@ -0,0 +1,128 @@
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "hv/hlog.h"
+
+// Call site of a log statement, one static instance per ALOG* macro expansion.
+// Carries the per-site rate limit window.
+struct LogSite
+{
+    const char* file;
+    int line;
+    std::atomic<int64_t> window{ 0 };       // current one second window
+    std::atomic<uint32_t> count{ 0 };       // records emitted in that window
+    std::atomic<uint32_t> suppressed{ 0 };  // records dropped by the rate limit
+
+    LogSite(const char* file, int line) : file(file), line(line) {
+    }
+};
+
+// Asynchronous logger on top of libhv's hlog.
+//
+// Producers format into a fixed size record of their own thread's ring buffer
+// (single producer / single consumer, no locks) and never block: when the ring is
+// full the record is dropped and counted. A background thread drains all rings
+// and hands the lines to an hlog logger, which does the actual console / file I/O.
+class AsyncLogger
+{
+public:
+    static constexpr size_t MESSAGE_SIZE = 224;
+
+    struct Config
+    {
+        Config() : level(LOG_LEVEL_INFO),
+            ring_size(256),
+            rate_limit(20),
+            handler(stdout_logger) {
+        }
+
+        int level;                  // LOG_LEVEL_* from hlog.h
+        size_t ring_size;           // records per thread, rounded up to a power of two
+        uint32_t rate_limit;        // records per second and call site, 0 disables
+        logger_handler handler;     // stdout_logger, stderr_logger or file_logger
+        std::string file;           // log file of file_logger
+    };
+
+    static AsyncLogger& getInstance();
+
+    void start(const Config& config = Config());
+    // Drain everything queued so far and join the writer
+    void stop();
+
+    void setLevel(int level) { level_.store(level, std::memory_order_relaxed); }
+    bool enabled(int level) const { return level >= level_.load(std::memory_order_relaxed); }
+
+    void log(LogSite& site, int level, const char* fmt, ...) __attribute__((format(printf, 4, 5)));
+
+private:
+    struct Record
+    {
+        int64_t time_us;
+        const LogSite* site;
+        uint32_t thread;
+        uint16_t level;
+        uint16_t length;
+        uint32_t suppressed;        // rate limited records of the site before this one
+        char message[MESSAGE_SIZE];
+    };
+
+    struct Ring
+    {
+        explicit Ring(size_t capacity) : records(capacity), mask(capacity - 1) {
+        }
+
+        std::vector<Record> records;
+        size_t mask;
+        uint32_t thread = 0;
+        std::atomic<bool> closed{ false };
+        alignas(64) std::atomic<size_t> head{ 0 };  // written by the producer
+        alignas(64) std::atomic<size_t> tail{ 0 };  // written by the writer thread
+    };
+
+    Config config_;
+    std::atomic<int> level_{ LOG_LEVEL_INFO };
+    std::atomic<size_t> ringSize_{ 256 };
+    std::atomic<uint32_t> rateLimit_{ 20 };
+    logger_t* logger_ = nullptr;
+
+    std::mutex ringsMutex_;     // only taken when a thread logs for the first time
+    std::vector<std::shared_ptr<Ring>> rings_;
+    std::atomic<uint32_t> nextThread_{ 0 };
+
+    std::thread writer_;
+    std::atomic<bool> running_{ false };
+    std::atomic<bool> pending_{ false };
+
+    AsyncLogger() = default;
+    ~AsyncLogger();
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    Ring& threadRing();
+    bool admit(LogSite& site, int64_t now_us, uint32_t& suppressed);
+    size_t drain();
+    void write(const Record& record);
+    void writerLoop();
+};
+
+#define ALOG(level, fmt, ...)                                                   \
+    do {                                                                        \
+        if (AsyncLogger::getInstance().enabled(level)) {                        \
+            static LogSite alog_site_(__FILENAME__, __LINE__);                  \
+            AsyncLogger::getInstance().log(alog_site_, level, fmt, ## __VA_ARGS__); \
+        }                                                                       \
+    } while (0)
+
+#define ALOGD(fmt, ...) ALOG(LOG_LEVEL_DEBUG, fmt, ## __VA_ARGS__)
+#define ALOGI(fmt, ...) ALOG(LOG_LEVEL_INFO,  fmt, ## __VA_ARGS__)
+#define ALOGW(fmt, ...) ALOG(LOG_LEVEL_WARN,  fmt, ## __VA_ARGS__)
+#define ALOGE(fmt, ...) ALOG(LOG_LEVEL_ERROR, fmt, ## __VA_ARGS__)
+
+#endif // ASYNC_LOGGER_H
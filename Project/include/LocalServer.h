@@ -0,0 +1,90 @@
+#ifndef LOCAL_SERVER_H
+#define LOCAL_SERVER_H
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include "json.hpp"
+#include "StaticFiles.h"
+#include "hv/WebSocketServer.h"
+
+// LAN facing HTTP + WebSocket API of the feeder.
+//
+//   GET  /api/state                    current state
+//   GET  /api/history?since=&limit=    sampled state history (since in ms since epoch)
+//   GET  /api/health                   worker heartbeats, 503 while a worker is stalled
+//   POST /api/command                  same JSON body as the MQTT /Pet/post topic, needs the
+//                                      command token, see Config::command_token
+//   GET  /metrics                      Prometheus metrics
+//   GET  /, /<asset>                   web dashboard, see StaticFiles
+//   WS   /ws                           {"type":"state"} on open, {"type":"delta"} on change;
+//                                      accepts {"type":"command",...} and {"type":"history",...},
+//                                      commands only on a socket opened with the command token
+class LocalServer
+{
+public:
+    using StateProvider = std::function<nlohmann::json()>;
+    using CommandHandler = std::function<void(const nlohmann::json&)>;
+
+    struct Config
+    {
+        Config() : port(8080),
+            thread_num(1),
+            history_size(3600),
+            history_interval_ms(1000) {
+        }
+
+        StaticFiles::Config web;
+
+        int port;
+        int thread_num;
+        size_t history_size;        // number of samples kept in memory
+        int history_interval_ms;    // minimum spacing of history samples
+        // Shared secret for commands, sent as "Authorization: Bearer <token>" or ?token=<token>.
+        // Commands drive the pump and servo, so they are refused while it is empty
+        std::string command_token;
+    };
+
+    static LocalServer& getInstance();
+
+    void setStateProvider(StateProvider provider);
+    void setCommandHandler(CommandHandler handler);
+
+    bool start(const Config& config = Config());
+    void stop();
+
+    // Record the latest state and push the changed fields to websocket clients
+    void publishState(const nlohmann::json& state);
+
+private:
+    Config config_;
+    hv::HttpService http_;
+    hv::WebSocketService ws_;
+    hv::WebSocketServer server_;
+    StaticFiles staticFiles_;
+
+    std::mutex mutex_;
+    StateProvider stateProvider_;
+    CommandHandler commandHandler_;
+    std::set<WebSocketChannelPtr> channels_;
+    std::set<WebSocketChannelPtr> commandChannels_;  // opened with the command token
+    nlohmann::json lastState_;
+    int64_t lastSampleMs_ = 0;
+    std::deque<nlohmann::json> history_;
+
+    LocalServer() = default;
+    ~LocalServer();
+    LocalServer(const LocalServer&) = delete;
+    LocalServer& operator=(const LocalServer&) = delete;
+
+    void registerRoutes();
+    bool authorized(HttpRequest* req) const;
+    bool dispatchCommand(const nlohmann::json& command);
+    nlohmann::json currentState();
+    nlohmann::json queryHistory(int64_t since_ms, size_t limit);
+    void onMessage(const WebSocketChannelPtr& channel, const std::string& msg);
+};
+
+#endif // LOCAL_SERVER_H
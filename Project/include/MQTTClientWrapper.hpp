@@ -4,6 +4,8 @@
 #include <cstring>
 #include <functional>
 #include "MQTTClient.h"
+#include "Metrics.h"
+#include "AsyncLogger.h"
 
 class MQTTClientWrapper {
 public:
@@ -37,8 +39,8 @@ public:
         initialized_ = true;
     }
 
-    // Connecting to the MQTT Agent
-    void connect(const std::string& username = "", const std::string& password = "") {
+    // Connecting to the MQTT Agent, gives up after timeoutSec (paho's default is 30s)
+    void connect(const std::string& username = "", const std::string& password = "", int timeoutSec = 30) {
         std::lock_guard<std::mutex> lock(mutex_);
 
         if (!initialized_) {
@@ -49,6 +51,7 @@ public:
         MQTTClient_SSLOptions ssl_opts = MQTTClient_SSLOptions_initializer;
         conn_opts.keepAliveInterval = 60;
         conn_opts.cleansession = 1;
+        conn_opts.connectTimeout = timeoutSec;
         conn_opts.ssl = &ssl_opts;  // Pass legal left address
 
         if (!username.empty()) {
@@ -64,9 +67,16 @@ public:
 
     // post a message
     void publish(const std::string& topic, const std::string& payload, int qos = 0) {
+        static LatencyHistogram& publishLatency = Metrics::getInstance().histogram(
+            "feeder_mqtt_publish", "MQTT publish round trip until the broker acknowledges");
+        static Counter& publishFailures = Metrics::getInstance().counter(
+            "feeder_mqtt_publish_failures_total", "MQTT publishes that failed or were not acknowledged");
+
         std::lock_guard<std::mutex> lock(mutex_);
+        auto start = std::chrono::steady_clock::now();
 
         if (!MQTTClient_isConnected(client_)) {
+            publishFailures.add();
             throw std::runtime_error("Not connected to broker");
         }
 
@@ -79,14 +89,19 @@ public:
         MQTTClient_deliveryToken token;
         int rc = MQTTClient_publishMessage(client_, topic.c_str(), &pubmsg, &token);
         if (rc != MQTTCLIENT_SUCCESS) {
+            publishFailures.add();
             throw std::runtime_error("Publish failed: " + std::to_string(rc));
         }
 
         // Wait for message acknowledgement (optional)
         rc = MQTTClient_waitForCompletion(client_, token, 1000L);
         if (rc != MQTTCLIENT_SUCCESS) {
+            publishFailures.add();
             throw std::runtime_error("Message not acknowledged: " + std::to_string(rc));
         }
+        // Only acknowledged publishes, a timeout would pin the histogram at the wait limit
+        publishLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
     }
 
     // Subscribe to threads
@@ -99,6 +114,11 @@ public:
         }
     }
 
+    bool isConnected() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return initialized_ && MQTTClient_isConnected(client_);
+    }
+
     // Disconnect
     void disconnect() {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -138,23 +158,35 @@ private:
     // Connection loss callback (static member function)
     static void connectionLostCallback(void* context, char* cause) {
         auto* instance = static_cast<MQTTClientWrapper*>(context);
-        std::cerr << "Connection lost! Cause: "
-            << (cause ? cause : "unknown") << std::endl;
+        ALOGW("Connection lost! Cause: %s", cause ? cause : "unknown");
         // Reconnect logic can be added here
     }
 
     // Message arrival callback (static member function)
     static int messageArrivedCallback(void* context, char* topicName, int topicLen,
         MQTTClient_message* message) {
+        static LatencyHistogram& handlerLatency = Metrics::getInstance().histogram(
+            "feeder_mqtt_handler", "Time spent in the MQTT message handler");
+        static Counter& received = Metrics::getInstance().counter(
+            "feeder_mqtt_messages_received_total", "MQTT messages received");
+
         auto* instance = static_cast<MQTTClientWrapper*>(context);
+        received.add();
 
         std::string topic(topicName);
         std::string payload(static_cast<char*>(message->payload), message->payloadlen);
 
         {
             std::lock_guard<std::mutex> lock(instance->mutex_);
-            if (instance->messageHandler_) {
-                instance->messageHandler_(topic, payload);
+            ScopeTimer timer(handlerLatency);
+            // An exception must not unwind into the paho network thread
+            try {
+                if (instance->messageHandler_) {
+                    instance->messageHandler_(topic, payload);
+                }
+            }
+            catch (const std::exception& e) {
+                ALOGE("MQTT handler failed on [%s]: %s", topic.c_str(), e.what());
             }
         }
 
@@ -166,7 +198,7 @@ private:
     // Message delivery callback (static member function)
     static void deliveryCompleteCallback(void* context, MQTTClient_deliveryToken token) {
         auto* instance = static_cast<MQTTClientWrapper*>(context);
-        std::cout << "Message with token " << token << " delivered" << std::endl;
+        ALOGD("Message with token %d delivered", token);
     }
 };
 
@@ -0,0 +1,153 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include "json.hpp"
+
+// Monotonically increasing counter, sharded per thread so that concurrent
+// writers never contend on the same cache line.
+class Counter
+{
+public:
+    static constexpr size_t SHARDS = 8;
+
+    Counter(const std::string& name, const std::string& help);
+
+    void add(uint64_t n = 1);
+    uint64_t value() const;
+
+    const std::string& name() const { return name_; }
+    const std::string& help() const { return help_; }
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> value{ 0 };
+    };
+
+    std::string name_;
+    std::string help_;
+    std::array<Shard, SHARDS> shards_;
+};
+
+// Value that can go up and down, e.g. a health flag or a queue depth.
+class Gauge
+{
+public:
+    Gauge(const std::string& name, const std::string& help);
+
+    void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+    const std::string& name() const { return name_; }
+    const std::string& help() const { return help_; }
+
+private:
+    std::string name_;
+    std::string help_;
+    std::atomic<int64_t> value_{ 0 };
+};
+
+// Log-linear (HDR style) latency histogram in microseconds.
+// Every power of two is split into SUB_BUCKETS linear buckets, which keeps the
+// relative error of a quantile below 1 / SUB_BUCKETS over the whole range.
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int MAX_BITS = 32;    // values are clamped to ~71 minutes
+    static constexpr int BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+    struct Snapshot
+    {
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+        uint64_t max_us = 0;
+        std::array<uint64_t, BUCKETS> buckets{};
+
+        // Upper bound of the bucket that holds quantile q (0 < q <= 1)
+        uint64_t quantile(double q) const;
+    };
+
+    LatencyHistogram(const std::string& name, const std::string& help);
+
+    void record(uint64_t us);
+    Snapshot snapshot() const;
+
+    const std::string& name() const { return name_; }
+    const std::string& help() const { return help_; }
+
+    static int bucketIndex(uint64_t us);
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    std::string name_;
+    std::string help_;
+    std::atomic<uint64_t> sum_us_{ 0 };
+    std::atomic<uint64_t> max_us_{ 0 };
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+};
+
+// RAII timer: records the lifetime of the scope into a histogram.
+class ScopeTimer
+{
+public:
+    explicit ScopeTimer(LatencyHistogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {
+    }
+
+    // Times from an earlier point, e.g. when the input that triggered the scope arrived
+    ScopeTimer(LatencyHistogram& histogram, std::chrono::steady_clock::time_point start)
+        : histogram_(histogram), start_(start) {
+    }
+
+    ~ScopeTimer()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        histogram_.record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+
+private:
+    LatencyHistogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+
+    ScopeTimer(const ScopeTimer&) = delete;
+    ScopeTimer& operator=(const ScopeTimer&) = delete;
+};
+
+// Process wide metric registry.
+// Registration takes a lock and is meant for start-up; the returned references
+// stay valid for the lifetime of the process and are lock-free to update.
+class Metrics
+{
+public:
+    static Metrics& getInstance();
+
+    Counter& counter(const std::string& name, const std::string& help);
+    Gauge& gauge(const std::string& name, const std::string& help);
+    LatencyHistogram& histogram(const std::string& name, const std::string& help);
+
+    // Prometheus text exposition format (version 0.0.4)
+    std::string toPrometheus();
+    // Compact summary used for the periodic MQTT digest
+    nlohmann::json digest();
+
+private:
+    std::mutex mutex_;
+    std::deque<Counter> counters_;
+    std::deque<Gauge> gauges_;
+    std::deque<LatencyHistogram> histograms_;
+
+    Metrics() = default;
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+};
+
+#endif // METRICS_H
@@ -7,6 +7,7 @@
 #include <fcntl.h>     // Add file control options
 #include <sys/ioctl.h> // Adding IO Control Commands
 #include <ctime>
+#include <chrono>
 class SerialPort
 {
 public:
@@ -39,6 +40,8 @@ public:
     ssize_t send(const uint8_t* data, size_t length);
     std::string receive();
     ssize_t receive(uint8_t* buffer, size_t max_length);
+    // When the first byte of the last binary receive() arrived
+    std::chrono::steady_clock::time_point firstByteTime() const { return first_byte_time_; }
 
     // Advanced Features
     void flushInput();
@@ -53,6 +56,7 @@ private:
     Config config_;
     int fd_ = -1;
     bool is_open_ = false;
+    std::chrono::steady_clock::time_point first_byte_time_;
 
     // Disable copy constructs and assignments
     SerialPort(const SerialPort&) = delete;
@@ -0,0 +1,75 @@
+#ifndef STATIC_FILES_H
+#define STATIC_FILES_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include "hv/HttpService.h"
+
+// Static file service for the web dashboard.
+//
+// Every file under the root is opened and memory-mapped once by load(), together with
+// its pre-built "<file>.br" / "<file>.gz" variants when they exist and are smaller.
+// Responses carry a strong ETag per representation. Only content hashed file names are
+// cached for good, the rest is revalidated with If-None-Match. The body goes out with sendfile() so the kernel copies straight from the page cache.
+class StaticFiles
+{
+public:
+    struct Config
+    {
+        Config() : index("index.html"),
+            max_age(31536000) {
+        }
+
+        std::string root;       // empty: "web" next to the executable
+        std::string index;      // served for "/"
+        int max_age;            // Cache-Control max-age of content hashed files, in seconds
+    };
+
+    StaticFiles() = default;
+    ~StaticFiles();
+    StaticFiles(const StaticFiles&) = delete;
+    StaticFiles& operator=(const StaticFiles&) = delete;
+
+    // Map all assets, returns the number of files loaded
+    size_t load(const Config& config = Config());
+    void unload();
+
+    // libhv staticHandler for GET / HEAD requests no API route matched
+    int serve(const HttpContextPtr& ctx);
+
+private:
+    enum Encoding
+    {
+        IDENTITY = 0,
+        GZIP,
+        BROTLI,
+        ENCODINGS
+    };
+
+    struct Variant
+    {
+        int fd = -1;
+        const char* data = nullptr;
+        size_t size = 0;
+        std::string etag;
+    };
+
+    struct Asset
+    {
+        std::string content_type;
+        std::string cache_control;
+        Variant variants[ENCODINGS];
+    };
+
+    Config config_;
+    std::map<std::string, Asset> assets_;   // keyed by url path, e.g. "/index.html"
+
+    static bool mapFile(const std::string& path, Variant& variant);
+    static void unmapFile(Variant& variant);
+    static bool acceptsEncoding(const std::string& header, const char* coding);
+    static bool isFingerprinted(const std::string& stem);
+    void sendBody(const HttpContextPtr& ctx, const Variant& variant);
+};
+
+#endif // STATIC_FILES_H
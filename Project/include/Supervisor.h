@@ -0,0 +1,118 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "json.hpp"
+#include "Metrics.h"
+
+// Runs the feeder's worker loops and watches over them.
+//
+// Each worker is one loop iteration run over and over on its own thread; the
+// supervisor stamps an atomic heartbeat before every iteration and restarts the
+// loop when an iteration throws. A worker whose heartbeat is older than stall_ms
+// is reported unhealthy and its stall handler is called, which is where the
+// owner resets the stalled subsystem. Past fatal_ms the supervisor stops feeding
+// the systemd / hardware watchdog (or exits when there is none), so a stuck
+// sensor read ends in a restart within seconds. The shutdown hook runs as soon
+// as a worker passes fatal_ms, so the actuators wait for that restart in a safe
+// state.
+class Supervisor
+{
+public:
+    using Task = std::function<void()>;
+    using StallHandler = std::function<void()>;
+    using ShutdownHook = std::function<void()>;
+
+    struct Config
+    {
+        Config() : check_interval_ms(500),
+            hardware_timeout_s(15) {
+        }
+
+        int check_interval_ms;
+        std::string hardware_watchdog;  // e.g. "/dev/watchdog", empty to disable
+        int hardware_timeout_s;
+    };
+
+    struct WorkerConfig
+    {
+        WorkerConfig() : stall_ms(3000),
+            fatal_ms(15000),
+            restart_backoff_ms(1000) {
+        }
+
+        int stall_ms;               // heartbeat age at which the worker is unhealthy
+        int fatal_ms;               // heartbeat age at which the process gives up
+        int restart_backoff_ms;     // delay before re-entering the loop after an exception
+    };
+
+    static Supervisor& getInstance();
+
+    // Start a worker thread running task in a loop
+    void spawn(const std::string& name, Task task,
+        const WorkerConfig& config = WorkerConfig(), StallHandler onStall = nullptr);
+
+    // Run once when a worker passes its fatal limit, before the reset
+    void setShutdownHook(ShutdownHook hook);
+
+    // Monitor the workers on the calling thread until stop()
+    void run(const Config& config = Config());
+    void stop();
+
+    // Per worker health, served on /api/health
+    nlohmann::json health();
+    bool healthy() const { return healthy_.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker
+    {
+        Worker(const std::string& name, Task task, const WorkerConfig& config, StallHandler onStall);
+
+        std::string name;
+        Task task;
+        WorkerConfig config;
+        StallHandler onStall;
+        std::thread thread;
+
+        std::atomic<int64_t> lastBeatUs{ 0 };
+        std::atomic<bool> stalled{ false };
+        bool fatal = false;
+        Counter& restarts;
+        Counter& stalls;
+        Gauge& up;
+        LatencyHistogram& interval;
+
+        void beat();
+    };
+
+    Config config_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    ShutdownHook shutdownHook_;
+    bool shutdownHookRan_ = false;     // only touched by run()
+    std::atomic<bool> running_{ true };
+    std::atomic<bool> healthy_{ true };
+
+    int watchdogFd_ = -1;
+    bool systemdWatchdog_ = false;
+
+    Supervisor() = default;
+    ~Supervisor();
+    Supervisor(const Supervisor&) = delete;
+    Supervisor& operator=(const Supervisor&) = delete;
+
+    void workerLoop(Worker& worker);
+    bool check(int64_t now_us);
+    void runShutdownHook();
+    void openWatchdog();
+    void feedWatchdog();
+    void closeWatchdog();
+};
+
+#endif // SUPERVISOR_H
@@ -0,0 +1,270 @@
+#include "AsyncLogger.h"
+#include "Metrics.h"
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <ctime>
+
+static Counter& mDropped = Metrics::getInstance().counter(
+    "feeder_log_dropped_total", "Log records dropped because the thread ring was full");
+static Counter& mSuppressed = Metrics::getInstance().counter(
+    "feeder_log_suppressed_total", "Log records dropped by the per call site rate limit");
+
+static int64_t nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static const char* levelName(int level)
+{
+    switch (level)
+    {
+    case LOG_LEVEL_DEBUG: return "DEBUG";
+    case LOG_LEVEL_INFO: return "INFO ";
+    case LOG_LEVEL_WARN: return "WARN ";
+    case LOG_LEVEL_ERROR: return "ERROR";
+    case LOG_LEVEL_FATAL: return "FATAL";
+    default: return "VERB ";
+    }
+}
+
+// Singleton pattern to get the logger
+AsyncLogger& AsyncLogger::getInstance()
+{
+    static AsyncLogger logger;
+    return logger;
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    stop();
+    if (logger_)
+        logger_destroy(logger_);
+}
+
+void AsyncLogger::start(const Config& config)
+{
+    if (running_.exchange(true))
+        return;
+
+    config_ = config;
+    size_t ringSize = 1;
+    while (ringSize < config_.ring_size)
+    {
+        ringSize <<= 1;
+    }
+    ringSize_.store(ringSize, std::memory_order_relaxed);
+    rateLimit_.store(config_.rate_limit, std::memory_order_relaxed);
+    level_.store(config_.level, std::memory_order_relaxed);
+
+    // Lines are fully formatted here, hlog only does the I/O
+    if (!logger_)
+        logger_ = logger_create();
+    logger_set_format(logger_, "%s");
+    logger_set_level(logger_, LOG_LEVEL_VERBOSE);
+    if (config_.handler == file_logger)
+    {
+        logger_set_handler(logger_, nullptr);
+        if (!config_.file.empty())
+            logger_set_file(logger_, config_.file.c_str());
+    }
+    else
+    {
+        logger_set_handler(logger_, config_.handler);
+    }
+
+    writer_ = std::thread(&AsyncLogger::writerLoop, this);
+}
+
+void AsyncLogger::stop()
+{
+    if (!running_.exchange(false))
+        return;
+
+    pending_.store(true);
+    pending_.notify_one();
+    if (writer_.joinable())
+        writer_.join();
+    logger_fsync(logger_);
+}
+
+AsyncLogger::Ring& AsyncLogger::threadRing()
+{
+    // Keeps the ring alive for the writer after the thread exits
+    struct Handle
+    {
+        std::shared_ptr<Ring> ring;
+        ~Handle()
+        {
+            if (ring)
+                ring->closed.store(true, std::memory_order_release);
+        }
+    };
+    thread_local Handle handle;
+
+    if (!handle.ring)
+    {
+        handle.ring = std::make_shared<Ring>(ringSize_.load(std::memory_order_relaxed));
+        handle.ring->thread = nextThread_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        rings_.push_back(handle.ring);
+    }
+    return *handle.ring;
+}
+
+// Fixed one second window per call site; the first record after a suppressed
+// burst reports how many were dropped
+bool AsyncLogger::admit(LogSite& site, int64_t now_us, uint32_t& suppressed)
+{
+    uint32_t limit = rateLimit_.load(std::memory_order_relaxed);
+    if (limit == 0)
+        return true;
+
+    int64_t window = now_us / 1000000;
+    int64_t current = site.window.load(std::memory_order_relaxed);
+    if (current != window && site.window.compare_exchange_strong(current, window, std::memory_order_relaxed))
+        site.count.store(0, std::memory_order_relaxed);
+
+    if (site.count.fetch_add(1, std::memory_order_relaxed) < limit)
+    {
+        suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    site.suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void AsyncLogger::log(LogSite& site, int level, const char* fmt, ...)
+{
+    int64_t now = nowUs();
+    uint32_t suppressed = 0;
+    if (!admit(site, now, suppressed))
+    {
+        mSuppressed.add();
+        return;
+    }
+
+    Ring& ring = threadRing();
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) > ring.mask)
+    {
+        // Never wait for the writer, keep the suppressed count for the next record
+        site.suppressed.fetch_add(suppressed, std::memory_order_relaxed);
+        mDropped.add();
+        return;
+    }
+
+    Record& record = ring.records[head & ring.mask];
+    record.time_us = now;
+    record.site = &site;
+    record.thread = ring.thread;
+    record.level = static_cast<uint16_t>(level);
+    record.suppressed = suppressed;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(record.message, MESSAGE_SIZE, fmt, ap);
+    va_end(ap);
+    record.length = static_cast<uint16_t>(len < 0 ? 0 : (len >= (int)MESSAGE_SIZE ? MESSAGE_SIZE - 1 : len));
+
+    ring.head.store(head + 1, std::memory_order_release);
+
+    // Only the first record of a batch wakes the writer. Pairs with the fence in writerLoop():
+    // either the writer sees this head or this exchange sees its pending_ reset
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!pending_.exchange(true, std::memory_order_acq_rel))
+        pending_.notify_one();
+}
+
+size_t AsyncLogger::drain()
+{
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        rings = rings_;
+    }
+
+    // Take every ring's published records at once, then merge them by time so records
+    // of different threads come out in the order they were logged
+    struct Cursor
+    {
+        Ring* ring;
+        size_t tail;
+        size_t head;
+        bool closed;
+    };
+    std::vector<Cursor> cursors;
+    cursors.reserve(rings.size());
+    for (const auto& ring : rings)
+    {
+        bool closed = ring->closed.load(std::memory_order_acquire);
+        cursors.push_back({ ring.get(), ring->tail.load(std::memory_order_relaxed),
+            ring->head.load(std::memory_order_acquire), closed });
+    }
+
+    size_t written = 0;
+    while (true)
+    {
+        Cursor* next = nullptr;
+        for (auto& cursor : cursors)
+        {
+            if (cursor.tail != cursor.head && (!next ||
+                cursor.ring->records[cursor.tail & cursor.ring->mask].time_us <
+                next->ring->records[next->tail & next->ring->mask].time_us))
+            {
+                next = &cursor;
+            }
+        }
+        if (!next)
+            break;
+        write(next->ring->records[next->tail & next->ring->mask]);
+        next->tail++;
+        next->ring->tail.store(next->tail, std::memory_order_release);
+        written++;
+    }
+
+    for (size_t i = 0; i < rings.size(); i++)
+    {
+        if (cursors[i].closed)
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex_);
+            std::erase(rings_, rings[i]);
+        }
+    }
+    return written;
+}
+
+void AsyncLogger::write(const Record& record)
+{
+    time_t seconds = static_cast<time_t>(record.time_us / 1000000);
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+
+    char line[MESSAGE_SIZE + 160];
+    int len = snprintf(line, sizeof(line), "%s.%03d %s [T%u] %.*s [%s:%d]", stamp,
+        static_cast<int>(record.time_us / 1000 % 1000), levelName(record.level), record.thread,
+        static_cast<int>(record.length), record.message, record.site->file, record.site->line);
+    if (record.suppressed > 0 && len > 0 && len < (int)sizeof(line))
+    {
+        snprintf(line + len, sizeof(line) - len, " (%u similar suppressed)", record.suppressed);
+    }
+    logger_print(logger_, record.level, "%s", line);
+}
+
+void AsyncLogger::writerLoop()
+{
+    while (running_.load(std::memory_order_acquire))
+    {
+        pending_.wait(false, std::memory_order_acquire);
+        pending_.store(false, std::memory_order_relaxed);
+        // Keep the reset ahead of drain()'s head loads, or a record published in between finds
+        // pending_ still set, skips the wakeup and waits for the next one
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        drain();
+    }
+    // Flush whatever was logged before stop()
+    drain();
+}
@@ -0,0 +1,283 @@
+#include "LocalServer.h"
+#include "Metrics.h"
+#include "AsyncLogger.h"
+#include "Supervisor.h"
+#include <chrono>
+
+static int64_t nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Compact JSON response (HttpResponse::Json pretty prints)
+static int replyJson(HttpResponse* resp, const nlohmann::json& j, int status = 200)
+{
+    resp->status_code = static_cast<http_status>(status);
+    resp->content_type = APPLICATION_JSON;
+    resp->body = j.dump();
+    return status;
+}
+
+static std::string message(const char* type, const nlohmann::json& data)
+{
+    nlohmann::json j = nlohmann::json::object();
+    j["type"] = type;
+    j["data"] = data;
+    return j.dump();
+}
+
+// Singleton pattern to get the local server
+LocalServer& LocalServer::getInstance()
+{
+    static LocalServer server;
+    return server;
+}
+
+LocalServer::~LocalServer()
+{
+    stop();
+}
+
+void LocalServer::setStateProvider(StateProvider provider)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stateProvider_ = std::move(provider);
+}
+
+void LocalServer::setCommandHandler(CommandHandler handler)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    commandHandler_ = std::move(handler);
+}
+
+bool LocalServer::start(const Config& config)
+{
+    config_ = config;
+    size_t assets = staticFiles_.load(config_.web);
+    ALOGI("Local server: %zu web assets mapped", assets);
+    registerRoutes();
+
+    server_.registerHttpService(&http_);
+    server_.registerWebSocketService(&ws_);
+    server_.setPort(config_.port);
+    server_.setThreadNum(config_.thread_num);
+    if (server_.start() != 0)
+    {
+        ALOGE("Local server failed to listen on port %d", config_.port);
+        return false;
+    }
+    return true;
+}
+
+void LocalServer::stop()
+{
+    server_.stop();
+    std::lock_guard<std::mutex> lock(mutex_);
+    channels_.clear();
+    commandChannels_.clear();
+}
+
+void LocalServer::registerRoutes()
+{
+    http_.GET("/api/state", [this](HttpRequest*, HttpResponse* resp) {
+        return replyJson(resp, currentState());
+        });
+
+    http_.GET("/api/history", [this](HttpRequest* req, HttpResponse* resp) {
+        try
+        {
+            int64_t since = std::stoll(req->GetParam("since", "0"));
+            size_t limit = std::stoul(req->GetParam("limit", "0"));
+            return replyJson(resp, queryHistory(since, limit));
+        }
+        catch (const std::exception& e)
+        {
+            return replyJson(resp, { { "error", e.what() } }, 400);
+        }
+        });
+
+    http_.POST("/api/command", [this](HttpRequest* req, HttpResponse* resp) {
+        if (!authorized(req))
+            return replyJson(resp, { { "error", "missing or wrong command token" } }, 401);
+        nlohmann::json command = nlohmann::json::parse(req->body, nullptr, false);
+        if (command.is_discarded() || !command.is_object())
+            return replyJson(resp, { { "error", "invalid json" } }, 400);
+        try
+        {
+            if (!dispatchCommand(command))
+                return replyJson(resp, { { "error", "no command handler" } }, 503);
+        }
+        catch (const nlohmann::json::exception& e)
+        {
+            // A field of the wrong type must not take the whole feeder down
+            return replyJson(resp, { { "error", e.what() } }, 400);
+        }
+        return replyJson(resp, currentState());
+        });
+
+    http_.GET("/api/health", [](HttpRequest*, HttpResponse* resp) {
+        auto& supervisor = Supervisor::getInstance();
+        return replyJson(resp, supervisor.health(), supervisor.healthy() ? 200 : 503);
+        });
+
+    http_.GET("/metrics", [](HttpRequest*, HttpResponse* resp) {
+        return resp->String(Metrics::getInstance().toPrometheus());
+        });
+
+    // Only reached for GET / HEAD requests that no route above matched
+    http_.staticHandler = [this](const HttpContextPtr& ctx) {
+        return staticFiles_.serve(ctx);
+        };
+
+    ws_.onopen = [this](const WebSocketChannelPtr& channel, const HttpRequestPtr& req) {
+        std::string snapshot = message("state", currentState());
+        bool commands = authorized(req.get());
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            channels_.insert(channel);
+            if (commands)
+                commandChannels_.insert(channel);
+        }
+        channel->send(snapshot);
+        };
+    ws_.onmessage = [this](const WebSocketChannelPtr& channel, const std::string& msg) {
+        onMessage(channel, msg);
+        };
+    ws_.onclose = [this](const WebSocketChannelPtr& channel) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        channels_.erase(channel);
+        commandChannels_.erase(channel);
+        };
+}
+
+bool LocalServer::authorized(HttpRequest* req) const
+{
+    // config_ is only written by start(), before the server runs
+    if (config_.command_token.empty())
+        return false;
+    return req->GetHeader("Authorization") == "Bearer " + config_.command_token ||
+        req->GetParam("token") == config_.command_token;
+}
+
+bool LocalServer::dispatchCommand(const nlohmann::json& command)
+{
+    CommandHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handler = commandHandler_;
+    }
+    if (!handler)
+        return false;
+
+    handler(command);
+    // Push the result right away instead of waiting for the next state poll
+    publishState(currentState());
+    return true;
+}
+
+nlohmann::json LocalServer::currentState()
+{
+    StateProvider provider;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        provider = stateProvider_;
+    }
+    return provider ? provider() : nlohmann::json::object();
+}
+
+nlohmann::json LocalServer::queryHistory(int64_t since_ms, size_t limit)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto begin = history_.begin();
+    while (begin != history_.end() && (*begin)["t"].get<int64_t>() < since_ms)
+    {
+        ++begin;
+    }
+
+    size_t available = static_cast<size_t>(history_.end() - begin);
+    if (limit > 0 && available > limit)
+        begin += available - limit; // newest samples win
+
+    return nlohmann::json(std::vector<nlohmann::json>(begin, history_.end()));
+}
+
+void LocalServer::publishState(const nlohmann::json& state)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    nlohmann::json delta = nlohmann::json::object();
+    for (auto it = state.begin(); it != state.end(); ++it)
+    {
+        if (!lastState_.contains(it.key()) || lastState_[it.key()] != it.value())
+            delta[it.key()] = it.value();
+    }
+    if (delta.empty())
+        return;
+    lastState_ = state;
+
+    int64_t now = nowMs();
+    if (now - lastSampleMs_ >= config_.history_interval_ms)
+    {
+        nlohmann::json sample = state;
+        sample["t"] = now;
+        history_.push_back(std::move(sample));
+        if (history_.size() > config_.history_size)
+            history_.pop_front();
+        lastSampleMs_ = now;
+    }
+
+    if (channels_.empty())
+        return;
+    std::string msg = message("delta", delta);
+    for (const auto& channel : channels_)
+    {
+        if (channel->isConnected())
+            channel->send(msg);
+    }
+}
+
+void LocalServer::onMessage(const WebSocketChannelPtr& channel, const std::string& msg)
+{
+    nlohmann::json j = nlohmann::json::parse(msg, nullptr, false);
+    if (j.is_discarded() || !j.is_object())
+    {
+        channel->send(message("error", "invalid json"));
+        return;
+    }
+
+    try
+    {
+        std::string type = j.value("type", "command");
+        if (type == "command")
+        {
+            bool allowed;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                allowed = commandChannels_.count(channel) > 0;
+            }
+            if (!allowed)
+                channel->send(message("error", "missing or wrong command token"));
+            else if (!dispatchCommand(j))
+                channel->send(message("error", "no command handler"));
+        }
+        else if (type == "history")
+        {
+            channel->send(message("history",
+                queryHistory(j.value("since", int64_t(0)), j.value("limit", size_t(0)))));
+        }
+        else if (type == "state")
+        {
+            channel->send(message("state", currentState()));
+        }
+        else
+        {
+            channel->send(message("error", "unknown type: " + type));
+        }
+    }
+    catch (const nlohmann::json::exception& e)
+    {
+        // A field of the wrong type must not take the whole feeder down
+        channel->send(message("error", e.what()));
+    }
+}
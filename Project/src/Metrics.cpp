@@ -0,0 +1,215 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdio>
+
+// Each thread picks a counter shard once, round robin
+static size_t threadShard()
+{
+    static std::atomic<size_t> next{ 0 };
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % Counter::SHARDS;
+    return shard;
+}
+
+Counter::Counter(const std::string& name, const std::string& help)
+    : name_(name), help_(help)
+{
+}
+
+void Counter::add(uint64_t n)
+{
+    shards_[threadShard()].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const
+{
+    uint64_t total = 0;
+    for (const auto& shard : shards_)
+    {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Gauge::Gauge(const std::string& name, const std::string& help)
+    : name_(name), help_(help)
+{
+}
+
+LatencyHistogram::LatencyHistogram(const std::string& name, const std::string& help)
+    : name_(name), help_(help)
+{
+}
+
+int LatencyHistogram::bucketIndex(uint64_t us)
+{
+    if (us < SUB_BUCKETS)
+        return static_cast<int>(us);
+
+    int msb = 63 - __builtin_clzll(us);
+    if (msb >= MAX_BITS)
+        return BUCKETS - 1;
+    int shift = msb - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + static_cast<int>((us >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < SUB_BUCKETS)
+        return static_cast<uint64_t>(index);
+
+    int shift = index / SUB_BUCKETS - 1;
+    uint64_t sub = static_cast<uint64_t>(index % SUB_BUCKETS);
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t us)
+{
+    buckets_[bucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t prev = max_us_.load(std::memory_order_relaxed);
+    while (prev < us && !max_us_.compare_exchange_weak(prev, us, std::memory_order_relaxed))
+    {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot snap;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        snap.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        snap.count += snap.buckets[i];
+    }
+    snap.sum_us = sum_us_.load(std::memory_order_relaxed);
+    snap.max_us = max_us_.load(std::memory_order_relaxed);
+    return snap;
+}
+
+uint64_t LatencyHistogram::Snapshot::quantile(double q) const
+{
+    if (count == 0)
+        return 0;
+
+    uint64_t rank = static_cast<uint64_t>(q * count + 0.5);
+    rank = std::clamp<uint64_t>(rank, 1, count);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return std::min(bucketUpperBound(i), max_us);
+    }
+    return max_us;
+}
+
+// Singleton pattern to get the metric registry
+Metrics& Metrics::getInstance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+Counter& Metrics::counter(const std::string& name, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& c : counters_)
+    {
+        if (c.name() == name)
+            return c;
+    }
+    return counters_.emplace_back(name, help);
+}
+
+Gauge& Metrics::gauge(const std::string& name, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& g : gauges_)
+    {
+        if (g.name() == name)
+            return g;
+    }
+    return gauges_.emplace_back(name, help);
+}
+
+LatencyHistogram& Metrics::histogram(const std::string& name, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& h : histograms_)
+    {
+        if (h.name() == name)
+            return h;
+    }
+    return histograms_.emplace_back(name, help);
+}
+
+std::string Metrics::toPrometheus()
+{
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out;
+    char line[256];
+
+    for (const auto& c : counters_)
+    {
+        out += "# HELP " + c.name() + " " + c.help() + "\n";
+        out += "# TYPE " + c.name() + " counter\n";
+        snprintf(line, sizeof(line), "%s %llu\n", c.name().c_str(),
+            static_cast<unsigned long long>(c.value()));
+        out += line;
+    }
+
+    for (const auto& g : gauges_)
+    {
+        out += "# HELP " + g.name() + " " + g.help() + "\n";
+        out += "# TYPE " + g.name() + " gauge\n";
+        snprintf(line, sizeof(line), "%s %lld\n", g.name().c_str(),
+            static_cast<long long>(g.value()));
+        out += line;
+    }
+
+    // Histograms are exported as summaries, the bucket layout is too fine for Prometheus
+    for (const auto& h : histograms_)
+    {
+        auto snap = h.snapshot();
+        std::string name = h.name() + "_seconds";
+        out += "# HELP " + name + " " + h.help() + "\n";
+        out += "# TYPE " + name + " summary\n";
+        for (double q : quantiles)
+        {
+            snprintf(line, sizeof(line), "%s{quantile=\"%g\"} %.6f\n", name.c_str(), q,
+                snap.quantile(q) / 1e6);
+            out += line;
+        }
+        snprintf(line, sizeof(line), "%s_sum %.6f\n%s_count %llu\n", name.c_str(),
+            snap.sum_us / 1e6, name.c_str(), static_cast<unsigned long long>(snap.count));
+        out += line;
+    }
+    return out;
+}
+
+nlohmann::json Metrics::digest()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json j = nlohmann::json::object();
+
+    for (const auto& c : counters_)
+    {
+        j["counters"][c.name()] = c.value();
+    }
+    for (const auto& g : gauges_)
+    {
+        j["gauges"][g.name()] = g.value();
+    }
+    for (const auto& h : histograms_)
+    {
+        auto snap = h.snapshot();
+        j["latency_us"][h.name()] = {
+            { "count", snap.count },
+            { "p50", snap.quantile(0.5) },
+            { "p99", snap.quantile(0.99) },
+            { "max", snap.max_us },
+        };
+    }
+    return j;
+}
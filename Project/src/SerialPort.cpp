@@ -1,4 +1,5 @@
 #include "SerialPort.h"
+#include "Metrics.h"
 #include <stdexcept>
 #include <unistd.h>
 #include <wiringPi.h>
@@ -109,6 +110,11 @@ std::string SerialPort::receive()
 // Receive binary data
 ssize_t SerialPort::receive(uint8_t* buffer, size_t max_length)
 {
+    static Counter& rxBytes = Metrics::getInstance().counter(
+        "feeder_serial_rx_bytes_total", "Bytes received on the serial port");
+    static Counter& rxShortReads = Metrics::getInstance().counter(
+        "feeder_serial_rx_short_reads_total", "Binary receives that returned fewer bytes than requested");
+
     if (!is_open_)
         return -1;
 
@@ -121,6 +127,8 @@ ssize_t SerialPort::receive(uint8_t* buffer, size_t max_length)
         int avail = serialDataAvail(fd_);
         if (avail > 0)
         {
+            if (received == 0)
+                first_byte_time_ = std::chrono::steady_clock::now();
             buffer[received++] = static_cast<uint8_t>(serialGetchar(fd_));
         }
         else
@@ -128,6 +136,10 @@ ssize_t SerialPort::receive(uint8_t* buffer, size_t max_length)
             usleep(10000); // wait 10ms
         }
     }
+
+    rxBytes.add(received);
+    if (received < max_length)
+        rxShortReads.add();
     return static_cast<ssize_t>(received);
 }
 
@@ -0,0 +1,265 @@
+#include "StaticFiles.h"
+#include "Metrics.h"
+#include "AsyncLogger.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hv/hbase.h"
+
+static Counter& mSendfileBytes = Metrics::getInstance().counter(
+    "feeder_static_sendfile_bytes_total", "Static asset bytes sent zero-copy with sendfile()");
+static Counter& mBufferedBytes = Metrics::getInstance().counter(
+    "feeder_static_buffered_bytes_total", "Static asset bytes queued in the libhv write buffer");
+static Counter& mNotModified = Metrics::getInstance().counter(
+    "feeder_static_not_modified_total", "Static asset requests answered with 304");
+
+// FNV-1a, only used to derive strong ETags once at startup
+static uint64_t fnv1a(const char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+StaticFiles::~StaticFiles()
+{
+    unload();
+}
+
+bool StaticFiles::mapFile(const std::string& path, Variant& variant)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    variant.fd = fd;
+    variant.data = static_cast<const char*>(data);
+    variant.size = static_cast<size_t>(st.st_size);
+
+    char etag[32];
+    snprintf(etag, sizeof(etag), "\"%016llx\"",
+        static_cast<unsigned long long>(fnv1a(variant.data, variant.size)));
+    variant.etag = etag;
+    return true;
+}
+
+void StaticFiles::unmapFile(Variant& variant)
+{
+    if (variant.data)
+        munmap(const_cast<char*>(variant.data), variant.size);
+    if (variant.fd >= 0)
+        ::close(variant.fd);
+    variant = Variant();
+}
+
+size_t StaticFiles::load(const Config& config)
+{
+    namespace fs = std::filesystem;
+    static const char* suffixes[ENCODINGS] = { "", ".gz", ".br" };
+
+    unload();
+    config_ = config;
+    if (config_.root.empty())
+    {
+        char dir[256] = { 0 };
+        get_executable_dir(dir, sizeof(dir));
+        config_.root = std::string(dir) + "/web";
+    }
+
+    std::error_code ec;
+    fs::recursive_directory_iterator it(config_.root, ec), end;
+    if (ec)
+    {
+        ALOGE("Static files: cannot open %s: %s", config_.root.c_str(), ec.message().c_str());
+        return 0;
+    }
+
+    for (; it != end; it.increment(ec))
+    {
+        if (ec || !it->is_regular_file())
+            continue;
+        const fs::path& path = it->path();
+        std::string ext = path.extension().string();
+        if (ext == ".gz" || ext == ".br")
+            continue;
+
+        Asset asset;
+        if (!mapFile(path.string(), asset.variants[IDENTITY]))
+            continue;
+        for (int e = GZIP; e < ENCODINGS; e++)
+        {
+            Variant& variant = asset.variants[e];
+            // A variant that does not beat the original is dropped
+            if (mapFile(path.string() + suffixes[e], variant) &&
+                variant.size >= asset.variants[IDENTITY].size)
+            {
+                unmapFile(variant);
+            }
+        }
+
+        const char* type = ext.empty() ? nullptr : http_content_type_str_by_suffix(ext.c_str() + 1);
+        asset.content_type = type ? type : "application/octet-stream";
+        // Only a name that changes with the content may be cached for good, everything
+        // else is revalidated against its ETag so an upgrade shows up on the next load
+        if (isFingerprinted(path.stem().string()))
+            asset.cache_control = "public, max-age=" + std::to_string(config_.max_age) + ", immutable";
+        else
+            asset.cache_control = "no-cache";
+
+        std::string url = "/" + fs::relative(path, config_.root, ec).generic_string();
+        assets_.emplace(std::move(url), std::move(asset));
+    }
+    return assets_.size();
+}
+
+void StaticFiles::unload()
+{
+    for (auto& entry : assets_)
+    {
+        for (auto& variant : entry.second.variants)
+        {
+            unmapFile(variant);
+        }
+    }
+    assets_.clear();
+}
+
+// True if the Accept-Encoding header lists the coding without q=0
+bool StaticFiles::acceptsEncoding(const std::string& header, const char* coding)
+{
+    size_t pos = 0;
+    while (pos < header.size())
+    {
+        size_t comma = header.find(',', pos);
+        if (comma == std::string::npos)
+            comma = header.size();
+        std::string item = header.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        size_t begin = item.find_first_not_of(" \t");
+        if (begin == std::string::npos)
+            continue;
+        size_t semi = item.find(';', begin);
+        size_t stop = item.find_last_not_of(" \t", semi == std::string::npos ? item.size() - 1 : semi - 1);
+        if (item.compare(begin, stop - begin + 1, coding) != 0)
+            continue;
+
+        if (semi == std::string::npos)
+            return true;
+        size_t q = item.find("q=", semi);
+        return q == std::string::npos || std::strtod(item.c_str() + q + 2, nullptr) > 0;
+    }
+    return false;
+}
+
+bool StaticFiles::isFingerprinted(const std::string& stem)
+{
+    // "app.3f9a1c2e" style names from bundlers, at least 8 hex digits after the last dot
+    size_t dot = stem.rfind('.');
+    if (dot == std::string::npos || stem.size() - dot - 1 < 8)
+        return false;
+    for (size_t i = dot + 1; i < stem.size(); i++)
+    {
+        if (!std::isxdigit(static_cast<unsigned char>(stem[i])))
+            return false;
+    }
+    return true;
+}
+
+int StaticFiles::serve(const HttpContextPtr& ctx)
+{
+    std::string path = ctx->request->Path();
+    if (path == "/")
+        path += config_.index;
+    auto found = assets_.find(path);
+    if (found == assets_.end())
+        return HTTP_STATUS_NOT_FOUND;
+    const Asset& asset = found->second;
+
+    std::string accept = ctx->request->GetHeader("Accept-Encoding");
+    int encoding = IDENTITY;
+    if (asset.variants[BROTLI].data && acceptsEncoding(accept, "br"))
+        encoding = BROTLI;
+    else if (asset.variants[GZIP].data && acceptsEncoding(accept, "gzip"))
+        encoding = GZIP;
+    const Variant& variant = asset.variants[encoding];
+
+    auto& resp = ctx->response;
+    resp->headers["ETag"] = variant.etag;
+    resp->headers["Cache-Control"] = asset.cache_control;
+    resp->headers["Vary"] = "Accept-Encoding";
+
+    std::string match = ctx->request->GetHeader("If-None-Match");
+    if (!match.empty() && (match == "*" || match.find(variant.etag) != std::string::npos))
+    {
+        mNotModified.add();
+        resp->status_code = HTTP_STATUS_NOT_MODIFIED;
+        return HTTP_STATUS_NOT_MODIFIED;
+    }
+
+    resp->status_code = HTTP_STATUS_OK;
+    resp->headers["Content-Type"] = asset.content_type;
+    if (encoding == GZIP)
+        resp->headers["Content-Encoding"] = "gzip";
+    else if (encoding == BROTLI)
+        resp->headers["Content-Encoding"] = "br";
+
+    ctx->writer->EndHeaders("Content-Length", variant.size);
+    if (ctx->request->method != HTTP_HEAD)
+        sendBody(ctx, variant);
+    ctx->writer->End();
+    return HTTP_STATUS_UNFINISHED;
+}
+
+// Runs on the connection's IO thread, so nothing else writes to the socket meanwhile.
+// sendfile() stops once the socket buffer is full; the rest is queued from the mapping
+// and libhv flushes it when the socket becomes writable again.
+void StaticFiles::sendBody(const HttpContextPtr& ctx, const Variant& variant)
+{
+    const auto& writer = ctx->writer;
+    size_t sent = 0;
+    // Only when the headers are on the wire, otherwise the body would overtake them
+    if (hio_write_is_complete(writer->io()))
+    {
+        off_t offset = 0;
+        while (sent < variant.size)
+        {
+            ssize_t n = ::sendfile(writer->fd(), variant.fd, &offset, variant.size - sent);
+            if (n <= 0)
+                break;
+            sent += static_cast<size_t>(n);
+        }
+        mSendfileBytes.add(sent);
+    }
+
+    if (sent < variant.size)
+    {
+        writer->WriteBody(variant.data + sent, static_cast<int>(variant.size - sent));
+        mBufferedBytes.add(variant.size - sent);
+    }
+    writer->state = hv::HttpResponseWriter::SEND_BODY;
+}
@@ -0,0 +1,302 @@
+#include "Supervisor.h"
+#include "AsyncLogger.h"
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/watchdog.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static LatencyHistogram& mLoopLag = Metrics::getInstance().histogram(
+    "feeder_supervisor_loop_lag", "How late the supervisor check ran compared to its schedule");
+static Gauge& mHealthy = Metrics::getInstance().gauge(
+    "feeder_healthy", "1 while every worker heartbeat is within its stall limit");
+
+static int64_t steadyUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Minimal sd_notify(3), without linking libsystemd
+static bool sdNotify(const char* state)
+{
+    const char* path = getenv("NOTIFY_SOCKET");
+    if (!path || !*path)
+        return false;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    size_t len = strlen(path);
+    if (len >= sizeof(addr.sun_path))
+        return false;
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, len);
+    if (addr.sun_path[0] == '@')
+        addr.sun_path[0] = '\0';    // abstract namespace
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    ssize_t n = sendto(fd, state, strlen(state), MSG_NOSIGNAL,
+        reinterpret_cast<struct sockaddr*>(&addr), offsetof(struct sockaddr_un, sun_path) + len);
+    close(fd);
+    return n >= 0;
+}
+
+Supervisor::Worker::Worker(const std::string& name, Task task, const WorkerConfig& config, StallHandler onStall)
+    : name(name), task(std::move(task)), config(config), onStall(std::move(onStall)),
+    restarts(Metrics::getInstance().counter("feeder_worker_" + name + "_restarts_total",
+        "Times the " + name + " worker loop was restarted after an exception")),
+    stalls(Metrics::getInstance().counter("feeder_worker_" + name + "_stalls_total",
+        "Times the " + name + " worker missed its heartbeat deadline")),
+    up(Metrics::getInstance().gauge("feeder_worker_" + name + "_up",
+        "1 while the " + name + " worker heartbeat is fresh")),
+    interval(Metrics::getInstance().histogram("feeder_worker_" + name + "_loop",
+        "Time between two heartbeats of the " + name + " worker"))
+{
+}
+
+void Supervisor::Worker::beat()
+{
+    int64_t now = steadyUs();
+    int64_t last = lastBeatUs.exchange(now, std::memory_order_relaxed);
+    if (last > 0)
+        interval.record(static_cast<uint64_t>(now - last));
+}
+
+// Singleton pattern to get the supervisor
+Supervisor& Supervisor::getInstance()
+{
+    static Supervisor supervisor;
+    return supervisor;
+}
+
+Supervisor::~Supervisor()
+{
+    stop();
+    closeWatchdog();
+}
+
+void Supervisor::spawn(const std::string& name, Task task, const WorkerConfig& config, StallHandler onStall)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto worker = std::make_unique<Worker>(name, std::move(task), config, std::move(onStall));
+    Worker& ref = *worker;
+    ref.lastBeatUs.store(steadyUs(), std::memory_order_relaxed);
+    ref.up.set(1);
+    workers_.push_back(std::move(worker));
+    ref.thread = std::thread(&Supervisor::workerLoop, this, std::ref(ref));
+}
+
+void Supervisor::setShutdownHook(ShutdownHook hook)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdownHook_ = std::move(hook);
+}
+
+void Supervisor::runShutdownHook()
+{
+    if (shutdownHookRan_)
+        return;
+    shutdownHookRan_ = true;
+
+    ShutdownHook hook;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hook = shutdownHook_;
+    }
+    if (hook)
+    {
+        ALOGW("Supervisor: running the shutdown hook");
+        hook();
+    }
+}
+
+void Supervisor::workerLoop(Worker& worker)
+{
+    while (running_.load(std::memory_order_relaxed))
+    {
+        worker.beat();
+        try
+        {
+            worker.task();
+        }
+        catch (const std::exception& e)
+        {
+            worker.restarts.add();
+            ALOGE("Worker %s failed: %s, restarting in %d ms", worker.name.c_str(), e.what(),
+                worker.config.restart_backoff_ms);
+            std::this_thread::sleep_for(std::chrono::milliseconds(worker.config.restart_backoff_ms));
+        }
+        catch (...)
+        {
+            worker.restarts.add();
+            ALOGE("Worker %s failed, restarting in %d ms", worker.name.c_str(),
+                worker.config.restart_backoff_ms);
+            std::this_thread::sleep_for(std::chrono::milliseconds(worker.config.restart_backoff_ms));
+        }
+    }
+}
+
+void Supervisor::run(const Config& config)
+{
+    config_ = config;
+    openWatchdog();
+    sdNotify("READY=1");
+
+    const int64_t period = config_.check_interval_ms * 1000LL;
+    int64_t next = steadyUs() + period;
+    while (running_.load(std::memory_order_relaxed))
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(next - steadyUs()));
+        int64_t now = steadyUs();
+        mLoopLag.record(static_cast<uint64_t>(now > next ? now - next : 0));
+        next += period;
+        if (next < now)
+            next = now + period;    // do not try to catch up after a long pause
+
+        if (check(now))
+        {
+            feedWatchdog();
+            shutdownHookRan_ = false;
+            continue;
+        }
+
+        // A reset follows either way, do not leave the actuators running until then
+        runShutdownHook();
+        if (watchdogFd_ < 0 && !systemdWatchdog_)
+        {
+            // Nobody will reset us, so exit and let the service manager restart the feeder
+            ALOGE("Supervisor: worker stuck beyond its fatal limit, exiting");
+            AsyncLogger::getInstance().stop();
+            fflush(nullptr);
+            std::_Exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void Supervisor::stop()
+{
+    running_.store(false);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& worker : workers_)
+    {
+        if (worker->thread.joinable() && worker->thread.get_id() != std::this_thread::get_id())
+            worker->thread.join();
+    }
+}
+
+// Returns false once a worker is past its fatal limit
+bool Supervisor::check(int64_t now_us)
+{
+    std::vector<StallHandler> handlers;
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool alive = true;
+    bool healthy = true;
+    for (auto& worker : workers_)
+    {
+        int64_t age_ms = (now_us - worker->lastBeatUs.load(std::memory_order_relaxed)) / 1000;
+        if (age_ms > worker->config.stall_ms)
+        {
+            healthy = false;
+            if (!worker->stalled.exchange(true))
+            {
+                worker->stalls.add();
+                worker->up.set(0);
+                ALOGW("Worker %s stalled, no heartbeat for %lld ms", worker->name.c_str(),
+                    static_cast<long long>(age_ms));
+                if (worker->onStall)
+                    handlers.push_back(worker->onStall);
+            }
+            if (age_ms > worker->config.fatal_ms)
+            {
+                alive = false;
+                if (!worker->fatal)
+                {
+                    worker->fatal = true;
+                    ALOGE("Worker %s stuck for %lld ms, no longer feeding the watchdog",
+                        worker->name.c_str(), static_cast<long long>(age_ms));
+                }
+            }
+        }
+        else if (worker->stalled.exchange(false))
+        {
+            worker->fatal = false;
+            worker->up.set(1);
+            ALOGI("Worker %s recovered", worker->name.c_str());
+        }
+    }
+    lock.unlock();
+
+    healthy_.store(healthy, std::memory_order_relaxed);
+    mHealthy.set(healthy ? 1 : 0);
+    for (auto& handler : handlers)
+    {
+        handler();
+    }
+    return alive;
+}
+
+nlohmann::json Supervisor::health()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t now = steadyUs();
+    nlohmann::json j = nlohmann::json::object();
+    j["healthy"] = healthy_.load(std::memory_order_relaxed);
+    j["watchdog"] = watchdogFd_ >= 0 ? "hardware" : (systemdWatchdog_ ? "systemd" : "none");
+    for (const auto& worker : workers_)
+    {
+        j["workers"][worker->name] = {
+            { "up", !worker->stalled.load(std::memory_order_relaxed) },
+            { "heartbeat_age_ms", (now - worker->lastBeatUs.load(std::memory_order_relaxed)) / 1000 },
+            { "restarts", worker->restarts.value() },
+            { "stalls", worker->stalls.value() },
+        };
+    }
+    return j;
+}
+
+void Supervisor::openWatchdog()
+{
+    systemdWatchdog_ = getenv("NOTIFY_SOCKET") && getenv("WATCHDOG_USEC");
+    if (systemdWatchdog_)
+        ALOGI("Supervisor: feeding the systemd watchdog");
+
+    if (config_.hardware_watchdog.empty() || watchdogFd_ >= 0)
+        return;
+    watchdogFd_ = open(config_.hardware_watchdog.c_str(), O_WRONLY | O_CLOEXEC);
+    if (watchdogFd_ < 0)
+    {
+        ALOGW("Supervisor: cannot open %s: %s", config_.hardware_watchdog.c_str(), strerror(errno));
+        return;
+    }
+    int timeout = config_.hardware_timeout_s;
+    ioctl(watchdogFd_, WDIOC_SETTIMEOUT, &timeout);
+    ALOGI("Supervisor: feeding %s, timeout %d s", config_.hardware_watchdog.c_str(), timeout);
+}
+
+void Supervisor::feedWatchdog()
+{
+    if (systemdWatchdog_)
+        sdNotify("WATCHDOG=1");
+    if (watchdogFd_ >= 0)
+        ioctl(watchdogFd_, WDIOC_KEEPALIVE, 0);
+}
+
+void Supervisor::closeWatchdog()
+{
+    if (watchdogFd_ < 0)
+        return;
+    // Magic close: disarm the hardware watchdog on a clean shutdown
+    if (write(watchdogFd_, "V", 1) != 1)
+        ALOGW("Supervisor: watchdog magic close failed");
+    close(watchdogFd_);
+    watchdogFd_ = -1;
+}
@@ -6,11 +6,18 @@
 #include <softPwm.h>
 #include "MQTTClientWrapper.hpp"
 #include "SerialPort.h"
+#include "Metrics.h"
+#include "AsyncLogger.h"
+#include "Supervisor.h"
 #include "json.hpp"
+#include "LocalServer.h"
 #include <sstream>
 #include <chrono>
 #include <iostream>
 
+#include <atomic>
+#include <cstdlib>
+#include <memory>
 #include <thread>
 #define INFRA_RED_PIN 3        // IR sensor GPIO pin
 #define WATER_PUMP_PIN 25      // Water pump control pin
@@ -33,6 +40,20 @@ static std::string mUserName = "test";
 static std::string mPassWord = "test1234";
 static std::string mServerUrl = "mqtts://qfe6debf.ala.eu-central-1.emqxsl.com:8883";
 static std::string mClientId = "Pi5Pet";
+static std::string mMetricsTopic = "/Pet/metrics";
+
+// Metrics config
+static int mMetricsDigestPeriod = 20;   // in MQTT loop iterations (500ms each)
+
+// Hot path latency histograms
+static LatencyHistogram& mSerialActuateLatency = Metrics::getInstance().histogram(
+    "feeder_serial_actuate", "Serial frame received until the actuator command completed");
+static LatencyHistogram& mHx711ReadLatency = Metrics::getInstance().histogram(
+    "feeder_hx711_read", "HX711 weight read time");
+static LatencyHistogram& mServoMotionLatency = Metrics::getInstance().histogram(
+    "feeder_servo_motion", "Servo motion time");
+static Counter& mSerialFrames = Metrics::getInstance().counter(
+    "feeder_serial_frames_total", "Valid serial command frames received");
 
 // Initialize GPIOs
 void gpioInit(void)
@@ -50,6 +71,7 @@ void gpioInit(void)
 // Set servo motor angle (0 or 1 = different PWM duty cycles)
 void setServoAngle(int angle)
 {
+    ScopeTimer timer(mServoMotionLatency);
     softPwmWrite(SERVO_PIN, 0);
     delay(1000);
     switch (angle)
@@ -83,6 +105,16 @@ void closeWaterPump(void)
     digitalWrite(WATER_PUMP_PIN, LOW);
 }
 
+// Pump off and feeder closed, for when a worker is stuck and a restart follows
+void safeState(void)
+{
+    closeWaterPump();
+    servo_flag = 0;
+    softPwmWrite(SERVO_PIN, 15);    // the closed position of setServoAngle(0)
+    delay(500);
+    softPwmStop(SERVO_PIN);
+}
+
 // Utility: split string by space
 std::vector<std::string> splitString(const std::string& s)
 {
@@ -96,18 +128,69 @@ std::vector<std::string> splitString(const std::string& s)
     return tokens;
 }
 
+// Snapshot of the device state, shared by MQTT and the local API
+nlohmann::json buildState(void)
+{
+    nlohmann::json j = nlohmann::json::object();
+    j["mode"] = ((mode == 1) ? "Remote" : "Auto");
+    j["detection"] = !infrared_status;
+    j["weight"] = weights;
+    j["pump"] = water_pump_status;
+    j["servo"] = servo_status;
+    return j;
+}
 
+// Integer field of a command, 0 when missing or of another type
+static int commandField(const nlohmann::json& j, const char* key)
+{
+    auto it = j.find(key);
+    return (it != j.end() && it->is_number_integer()) ? it->get<int>() : 0;
+}
 
-int main(void)
+// Handle a remote command: {"mode":1,"state":0|1} pump, {"mode":2,"state":0|1} servo
+void handleCommand(const nlohmann::json& j)
 {
-    char value;
-    bool isExit = false;
-    bool isMqttConnStatus = false;
+    int cmdMode = commandField(j, "mode");
+    int cmdState = commandField(j, "state");
+    if (cmdMode == 1)
+    {
+        if (cmdState == 1)
+        {
+            openWaterPump();
+
+        }
+        else
+        {
+            closeWaterPump();
+
+        }
+    }
+    else if (cmdMode == 2)
+    {
+        if (cmdState == 1)
+        {
+            // setServoAngle(1);
+            servo_flag = 1;
+        }
+        else
+        {
+            // setServoAngle(0);
+            servo_flag = 2;
+        }
+    }
+}
 
+
+int main(void)
+{
+    AsyncLogger::getInstance().start();
     gpioInit();
 
     // Init weight sensor (DOUT, SCK, gain, offset, rate)
-    HX711::AdvancedHX711 hx(5, 6, 419, 233775, HX711::Rate::HZ_80);
+    auto makeHx711 = []() {
+        return std::make_unique<HX711::AdvancedHX711>(5, 6, 419, 233775, HX711::Rate::HZ_80);
+        };
+    std::unique_ptr<HX711::AdvancedHX711> hx = makeHx711();
 
 
     if (!serial_port.isOpen())
@@ -115,138 +198,153 @@ int main(void)
         serial_port.open();
     }
 
-    // Serial thread: reads commands and updates states
-    std::thread threadSeral([&]() {
-        while (!isExit)
+    // LAN API: http://<feeder>:8080/api/..., ws://<feeder>:8080/ws, /metrics
+    auto& localServer = LocalServer::getInstance();
+    localServer.setStateProvider(buildState);
+    localServer.setCommandHandler(handleCommand);
+    LocalServer::Config serverConfig;
+    if (const char* token = getenv("FEEDER_COMMAND_TOKEN"))
+        serverConfig.command_token = token;
+    else
+        ALOGW("FEEDER_COMMAND_TOKEN not set, the LAN API will refuse commands");
+    localServer.start(serverConfig);
+
+    auto& supervisor = Supervisor::getInstance();
+    Supervisor::WorkerConfig workerConfig;
+    supervisor.setShutdownHook(safeState);
+
+    // Stall handlers run on the supervisor thread; the stalled worker resets its
+    // own subsystem once it gets through, a worker that never does ends in a restart
+    std::atomic<bool> reopenSerial{ false };
+    std::atomic<bool> resetHx711{ false };
+    std::atomic<bool> weightsStale{ false };
+
+    // Serial worker: reads commands and updates states
+    supervisor.spawn("serial", [&]() {
+        if (reopenSerial.exchange(false))
         {
-            uint8_t array[5] = { 0 };
-            if (serial_port.receive(array, 5) > 0)
+            ALOGW("Reopening the serial port after a stall");
+            serial_port.close();
+            serial_port.open();
+        }
+        uint8_t array[5] = { 0 };
+        if (serial_port.receive(array, 5) > 0)
+        {
+            ALOGD("Serial frame %02X %02X %02X %02X %02X",
+                array[0], array[1], array[2], array[3], array[4]);
+            if (array[0] == 0xFD && array[2] == 0xFF)
             {
-                for (size_t i = 0; i < 5; i++)
-                {
-                    printf("%02X", array[i]);
-                }
-                printf("\r\n");
-                if (array[0] == 0xFD && array[2] == 0xFF)
+                // Count the frame's own transfer too, not just the actuation
+                ScopeTimer timer(mSerialActuateLatency, serial_port.firstByteTime());
+                mSerialFrames.add();
+                switch (array[1])
                 {
-                    switch (array[1])
-                    {
-                    case 1: { if (mode == 1) { openWaterPump(); }break; }
-                    case 2: { if (mode == 1) { setServoAngle(1); }break; }
-                    case 5: { if (mode == 1) { closeWaterPump(); }break; }
-                    case 6: { if (mode == 1) { setServoAngle(0); }break; }
-                    case 3: { mode = 0;break; }
-                    case 4: { mode = 1;break; }
-                    }
+                case 1: { if (mode == 1) { openWaterPump(); }break; }
+                case 2: { if (mode == 1) { setServoAngle(1); }break; }
+                case 5: { if (mode == 1) { closeWaterPump(); }break; }
+                case 6: { if (mode == 1) { setServoAngle(0); }break; }
+                case 3: { mode = 0;break; }
+                case 4: { mode = 1;break; }
                 }
             }
-            delay(100);
-        }}
-    );
+        }
+        delay(100);
+        }, workerConfig, [&]() { reopenSerial = true; });
 
-    // Automatic mode thread: logic for auto control
-    std::thread threadAutoMode([&]() {
-        while (!isExit)
+    // Automatic mode worker: logic for auto control
+    supervisor.spawn("auto", [&]() {
+        if (mode == 0)
         {
-            if (mode == 0)
+            if (infrared_status == LOW) // Pet detected
             {
-                if (infrared_status == LOW) // Pet detected
+                // A stale weight could keep the pump running without end
+                if (weights < weights_threshold && !weightsStale)
                 {
-                    if (weights < weights_threshold)
-                    {
-                        servo_flag = 1;
-                        openWaterPump();
-                        // setServoAngle(1);
-                    }
-                    else
-                    {
-                        servo_flag = 2;
-                        closeWaterPump();
-                        // setServoAngle(0);
-                    }
+                    servo_flag = 1;
+                    openWaterPump();
+                    // setServoAngle(1);
                 }
-                else {
+                else
+                {
+                    servo_flag = 2;
                     closeWaterPump();
-                    servo_flag = 0;
                     // setServoAngle(0);
                 }
             }
-
-            delay(100);
-        }}
-    );
-
-    // MQTT communication thread
-    std::thread threadMqtt(
-        [&]() {
-            auto& mqtt = MQTTClientWrapper::getInstance();
-            try {
-                mqtt.initialize(mServerUrl, mClientId);
-                mqtt.connect(mUserName, mPassWord);
-                mqtt.setMessageHandler([&](const std::string& topic, const std::string& msg) {
-                    std::cout << "Received message on [" << topic << "]: " << msg << std::endl;
-                    nlohmann::json j = nlohmann::json::parse(msg);
-                    if (j["mode"] == 1)
-                    {
-                        if (j["state"] == 1)
-                        {
-                            openWaterPump();
-
-                        }
-                        else
-                        {
-                            closeWaterPump();
-
-                        }
-                    }
-                    else if (j["mode"] == 2)
-                    {
-                        if (j["state"] == 1)
-                        {
-                            // setServoAngle(1);
-                            servo_flag = 1;
-                        }
-                        else
-                        {
-                            // setServoAngle(0);
-                            servo_flag = 2;
-                        }
-                    }
-                    });
-                mqtt.subscribe(mSubscribeToptic);
-                isMqttConnStatus = true;
-                // mqtt.publish("test/topic", "Hello MQTT");
-            }
-            catch (const std::exception& e) {
-                std::cerr << "MQTT Error: " << e.what() << std::endl;
-                isMqttConnStatus = false;
+            else {
+                closeWaterPump();
+                servo_flag = 0;
+                // setServoAngle(0);
             }
-            while (!isExit)
+        }
+
+        // Push changed fields to local websocket clients
+        localServer.publishState(buildState());
+        delay(100);
+        }, workerConfig);
+
+    // MQTT worker: (re)connects, then publishes the state every 500ms
+    auto& mqtt = MQTTClientWrapper::getInstance();
+    mqtt.setMessageHandler([&](const std::string& topic, const std::string& msg) {
+        ALOGI("Received message on [%s]: %s", topic.c_str(), msg.c_str());
+        nlohmann::json j = nlohmann::json::parse(msg, nullptr, false);
+        if (j.is_discarded() || !j.is_object())
+        {
+            ALOGW("Ignoring malformed command on [%s]", topic.c_str());
+            return;
+        }
+        handleCommand(j);
+        });
+    bool isMqttInitialized = false;
+    int digestTick = 0;
+    Supervisor::WorkerConfig mqttConfig;
+    // A connect attempt blocks the worker, so it has to give up well before the stall
+    // limit; otherwise an unreachable broker gets the whole process restarted
+    const int mqttConnectTimeoutSec = 5;
+    mqttConfig.stall_ms = 10000;
+    mqttConfig.restart_backoff_ms = 5000;
+    supervisor.spawn("mqtt", [&]() {
+        if (!mqtt.isConnected())
+        {
+            if (!isMqttInitialized)
             {
-                if (isMqttConnStatus)
-                {
-                    // Build json
-                    nlohmann::json j = nlohmann::json::object();
-                    j["mode"] = ((mode == 1) ? "Remote" : "Auto");
-                    j["detection"] = !infrared_status;
-                    j["weight"] = weights;
-                    j["pump"] = water_pump_status;
-                    j["servo"] = servo_status;
-                    mqtt.publish(mPublishTopic, j.dump());
-                    // serial_port.send("hello world!\r\n");
-                }
-                delay(500);
+                mqtt.initialize(mServerUrl, mClientId);
+                isMqttInitialized = true;
             }
-            mqtt.disconnect();
+            mqtt.connect(mUserName, mPassWord, mqttConnectTimeoutSec);
+            mqtt.subscribe(mSubscribeToptic);
+            ALOGI("MQTT connected to %s", mServerUrl.c_str());
         }
-    );
 
-    // Main loop: read sensors and update servo
-    while (1)
-    {
+        mqtt.publish(mPublishTopic, buildState().dump());
+        // serial_port.send("hello world!\r\n");
+
+        // Periodic metrics digest
+        if (++digestTick >= mMetricsDigestPeriod)
+        {
+            digestTick = 0;
+            mqtt.publish(mMetricsTopic, Metrics::getInstance().digest().dump());
+        }
+        delay(500);
+        }, mqttConfig);
+
+    // Sensor worker: read sensors and update servo
+    Supervisor::WorkerConfig sensorConfig;
+    sensorConfig.stall_ms = 5000;   // HX711 read (1s timeout) plus a servo move (1s)
+    supervisor.spawn("sensor", [&]() {
+        if (resetHx711.exchange(false))
+        {
+            ALOGW("Re-initializing the HX711 after a stall");
+            hx.reset();
+            hx = makeHx711();
+        }
         infrared_status = digitalRead(INFRA_RED_PIN);
         // setServoAngle(90);
-        weights = hx.weight(std::chrono::seconds(1)).getValue();
+        {
+            ScopeTimer timer(mHx711ReadLatency);
+            weights = hx->weight(std::chrono::seconds(1)).getValue();
+        }
+        weightsStale = false;
         if (weights < 0) weights = .0f;
         if (servo_flag == 1)
         {
@@ -257,9 +355,18 @@ int main(void)
         {
             setServoAngle(0);
         }
-    }
+        }, sensorConfig, [&]() {
+            weightsStale = true;
+            resetHx711 = true;
+            closeWaterPump();
+        });
 
+    // Watch the workers and feed the systemd / hardware watchdog
+    supervisor.run();
 
+    mqtt.disconnect();
+    AsyncLogger::getInstance().stop();
+    return 0;
 }
 #else
 
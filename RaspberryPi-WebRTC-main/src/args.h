@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include <linux/videodev2.h>
 
@@ -16,15 +17,37 @@ struct Args {
     int sample_rate = 44100;
     int peer_timeout = 10;
     int segment_duration = 60;
+    int simulcast_layers = 1;
+    int capture_buffers = 4;
+    int min_qp = 0;
+    int max_qp = 0;
+    int key_frame_interval = 600;
+    int intra_refresh = 0;
+    int hw_encoders = 0;
+    int idle_fps = 5;
+    int motion_area = 2;
+    int motion_hold = 10;
+    int pre_roll = 5;
+    int post_roll = 10;
     bool no_audio = false;
     bool hw_accel = false;
+    bool shared_encoder = false;
+    bool h264_passthrough = false;
     bool use_libcamera = false;
     bool use_mqtt = false;
     bool use_whep = false;
     bool fixed_resolution = false;
+    bool motion_detection = false;
+    bool motion_record = false;
+    bool event_record = false;
     uint32_t format = V4L2_PIX_FMT_MJPEG;
     std::string v4l2_format = "mjpeg";
+    int v4l2_bitrate_mode = V4L2_MPEG_VIDEO_BITRATE_MODE_VBR;
+    std::string bitrate_mode = "vbr";
+    int v4l2_h264_profile = V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE;
+    std::string h264_profile = "baseline";
     std::string camera = "libcamera:0";
+    std::vector<std::string> cameras;
     std::string uid = "";
     std::string stun_url = "stun:stun.l.google.com:19302";
     std::string turn_url = "";
@@ -1,9 +1,19 @@
 #include "libcamera_capturer.h"
 
+#include <algorithm>
 #include <sys/mman.h>
 
+// WebRTC
+#include <third_party/libyuv/include/libyuv.h>
+
+#include "common/frame_buffer_pool.h"
 #include "common/logging.h"
 
+// Below this many queued requests a new frame is copied out, or dropped in dma mode, so its
+// request goes straight back.
+const int MIN_QUEUED_REQUESTS = 2;
+const int STATS_INTERVAL_SEC = 10;
+
 std::shared_ptr<LibcameraCapturer> LibcameraCapturer::Create(Args args) {
     auto ptr = std::make_shared<LibcameraCapturer>(args);
     ptr->Init(args.cameraId);
@@ -15,7 +25,11 @@ std::shared_ptr<LibcameraCapturer> LibcameraCapturer::Create(Args args) {
 }
 
 LibcameraCapturer::LibcameraCapturer(Args args)
-    : buffer_count_(2),
+    : buffer_count_(args.capture_buffers),
+      queued_requests_(0),
+      frame_count_(0),
+      camera_dropped_(0),
+      last_sequence_(0),
       format_(args.format),
       config_(args) {}
 
@@ -58,7 +72,8 @@ int LibcameraCapturer::width() const { return width_; }
 
 int LibcameraCapturer::height() const { return height_; }
 
-bool LibcameraCapturer::is_dma_capture() const { return false; }
+// padded rows are repacked by the cpu, the v4l2 devices expect packed planes.
+bool LibcameraCapturer::is_dma_capture() const { return config_.hw_accel && stride_ == width_; }
 
 uint32_t LibcameraCapturer::format() const { return format_; }
 
@@ -88,13 +103,10 @@ LibcameraCapturer &LibcameraCapturer::SetFormat(int width, int height) {
     width_ = camera_config_->at(0).size.width;
     height_ = camera_config_->at(0).size.height;
     stride_ = camera_config_->at(0).stride;
+    buffer_count_ = camera_config_->at(0).bufferCount;
 
-    INFO_PRINT("  width: %d, height: %d, stride: %d", width_, height_, stride_);
-
-    if (width_ != stride_) {
-        ERROR_PRINT("Stride is not equal to width");
-        exit(1);
-    }
+    INFO_PRINT("  width: %d, height: %d, stride: %d, buffers: %d", width_, height_, stride_,
+               buffer_count_);
 
     return *this;
 }
@@ -116,6 +128,16 @@ LibcameraCapturer &LibcameraCapturer::SetControls(const int key, const int value
     return *this;
 }
 
+void LibcameraCapturer::SetFrameRateLimit(int fps) {
+    // the sensor itself slows down, which saves the isp work too. queued requests keep the old
+    // rate, so the change lands a few frames later.
+    int64_t frame_time = 1000000 / (fps > 0 ? std::min(fps, fps_) : fps_);
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    controls_.set(libcamera::controls::FrameDurationLimits,
+                  libcamera::Span<const int64_t, 2>({frame_time, frame_time}));
+    DEBUG_PRINT("Frame rate limit: %d", fps);
+}
+
 LibcameraCapturer &LibcameraCapturer::SetRotation(int angle) {
     if (angle == 90) {
         camera_config_->orientation = libcamera::Orientation::Rotate90;
@@ -172,12 +194,14 @@ void LibcameraCapturer::AllocateBuffer() {
 
 void LibcameraCapturer::RequestComplete(libcamera::Request *request) {
     if (request->status() == libcamera::Request::RequestCancelled) {
-        DEBUG_PRINT("Request has been cancelled");
-        exit(1);
+        // the camera is stopping, the request is not queued again.
+        return;
     }
+    int queued = queued_requests_.fetch_sub(1) - 1;
 
     auto &buffers = request->buffers();
     auto *buffer = buffers.begin()->second;
+    CountDroppedFrames(buffer->metadata().sequence);
 
     auto &plane = buffer->planes()[0];
     int fd = plane.fd.get();
@@ -187,9 +211,82 @@ void LibcameraCapturer::RequestComplete(libcamera::Request *request) {
     tv.tv_sec = buffer->metadata().timestamp / 1000000000;
     tv.tv_usec = (buffer->metadata().timestamp % 1000000000) / 1000;
 
+    if (stride_ != width_) {
+        // the packed copy is independent of the request, which goes back right away.
+        auto lease = PackPlanes(buffer, data, tv);
+        Requeue(request);
+        NextBuffer(V4L2FrameBuffer::Create(width_, height_, lease, format_));
+        return;
+    }
+
+    if (queued < MIN_QUEUED_REQUESTS && is_dma_capture()) {
+        // consumers hold too many frames and dma ones need the buffer itself, so a copy won't
+        // do. drop this frame to keep the camera fed.
+        DEBUG_PRINT("only %d requests queued, dropped a frame", queued);
+        Requeue(request);
+        return;
+    }
+
     V4L2Buffer v4l2_buffer((uint8_t *)data, length, V4L2_BUF_FLAG_KEYFRAME, tv);
-    NextBuffer(v4l2_buffer);
+    v4l2_buffer.dmafd = fd;
 
+    // the request is queued again once the last frame referring to its buffer is released.
+    std::weak_ptr<LibcameraCapturer> weak_this = weak_from_this();
+    auto lease = rtc::make_ref_counted<V4L2BufferLease>(v4l2_buffer, [weak_this, request]() {
+        if (auto capturer = weak_this.lock()) {
+            capturer->Requeue(request);
+        }
+    });
+
+    // consumers hold too many frames, keep the camera fed.
+    if (queued < MIN_QUEUED_REQUESTS) {
+        lease->Detach();
+    }
+
+    NextBuffer(V4L2FrameBuffer::Create(width_, height_, lease, format_));
+}
+
+rtc::scoped_refptr<V4L2BufferLease>
+LibcameraCapturer::PackPlanes(libcamera::FrameBuffer *buffer, void *data, timeval timestamp) {
+    auto &planes = buffer->planes();
+    auto *base = static_cast<uint8_t *>(data);
+    int chroma_width = (width_ + 1) / 2;
+    int chroma_height = (height_ + 1) / 2;
+    int size = width_ * height_ + chroma_width * chroma_height * 2;
+
+    auto block = std::make_shared<FrameDataPool::Block>(FrameDataPool::Shared()->Acquire(size));
+    uint8_t *dst_y = block->get();
+    uint8_t *dst_u = dst_y + width_ * height_;
+    uint8_t *dst_v = dst_u + chroma_width * chroma_height;
+    libyuv::I420Copy(base + planes[0].offset, stride_, base + planes[1].offset, stride_ / 2,
+                     base + planes[2].offset, stride_ / 2, dst_y, width_, dst_u, chroma_width,
+                     dst_v, chroma_width, width_, height_);
+
+    V4L2Buffer packed(dst_y, size, V4L2_BUF_FLAG_KEYFRAME, timestamp);
+    // the lease owns the block, it goes back to the pool with the last frame using it.
+    return rtc::make_ref_counted<V4L2BufferLease>(packed, [block]() {});
+}
+
+void LibcameraCapturer::CountDroppedFrames(uint32_t sequence) {
+    if (frame_count_ > 0 && sequence > last_sequence_ + 1) {
+        // no request was queued when the sensor delivered these frames.
+        camera_dropped_ += sequence - last_sequence_ - 1;
+    }
+    last_sequence_ = sequence;
+
+    if (++frame_count_ % (fps_ * STATS_INTERVAL_SEC) != 0) {
+        return;
+    }
+    std::string consumers;
+    for (auto dropped : DroppedFrames()) {
+        consumers += (consumers.empty() ? "" : ", ") + std::to_string(dropped);
+    }
+    DEBUG_PRINT("Captured %llu frames, camera dropped %llu, consumers dropped [%s]",
+                (unsigned long long)frame_count_, (unsigned long long)camera_dropped_,
+                consumers.c_str());
+}
+
+void LibcameraCapturer::Requeue(libcamera::Request *request) {
     request->reuse(libcamera::Request::ReuseBuffers);
 
     {
@@ -197,17 +294,19 @@ void LibcameraCapturer::RequestComplete(libcamera::Request *request) {
         request->controls() = controls_;
     }
 
-    camera_->queueRequest(request);
+    if (camera_->queueRequest(request) == 0) {
+        queued_requests_.fetch_add(1);
+    }
 }
 
 rtc::scoped_refptr<webrtc::I420BufferInterface> LibcameraCapturer::GetI420Frame() {
     return frame_buffer_->ToI420();
 }
 
-void LibcameraCapturer::NextBuffer(V4L2Buffer &buffer) {
-    frame_buffer_ = V4L2FrameBuffer::Create(width_, height_, buffer, format_);
+void LibcameraCapturer::NextBuffer(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+    frame_buffer_ = frame_buffer;
     NextFrameBuffer(frame_buffer_);
-    NextRawBuffer(buffer);
+    NextRawBuffer(frame_buffer_);
 }
 
 void LibcameraCapturer::StartCapture() {
@@ -233,6 +332,8 @@ void LibcameraCapturer::StartCapture() {
         if (ret < 0) {
             ERROR_PRINT("Can't queue request");
             camera_->stop();
+        } else {
+            queued_requests_.fetch_add(1);
         }
     }
 }
@@ -1,6 +1,7 @@
 #ifndef LIBCAMERA_CAPTURER_H_
 #define LIBCAMERA_CAPTURER_H_
 
+#include <atomic>
 #include <vector>
 
 #include <libcamera/libcamera.h>
@@ -13,7 +14,8 @@
 #include "common/v4l2_utils.h"
 #include "common/worker.h"
 
-class LibcameraCapturer : public VideoCapturer {
+class LibcameraCapturer : public VideoCapturer,
+                          public std::enable_shared_from_this<LibcameraCapturer> {
   public:
     static std::shared_ptr<LibcameraCapturer> Create(Args args);
 
@@ -27,6 +29,7 @@ class LibcameraCapturer : public VideoCapturer {
     Args config() const override;
 
     LibcameraCapturer &SetControls(const int key, const int value) override;
+    void SetFrameRateLimit(int fps) override;
     rtc::scoped_refptr<webrtc::I420BufferInterface> GetI420Frame() override;
     void StartCapture() override;
 
@@ -36,6 +39,10 @@ class LibcameraCapturer : public VideoCapturer {
     int height_;
     int stride_;
     int buffer_count_;
+    std::atomic<int> queued_requests_;
+    uint64_t frame_count_;
+    uint64_t camera_dropped_;
+    uint32_t last_sequence_;
     uint32_t format_;
     Args config_;
     std::mutex control_mutex_;
@@ -50,7 +57,7 @@ class LibcameraCapturer : public VideoCapturer {
     std::map<int, std::pair<void *, unsigned int>> mapped_buffers_;
 
     rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer_;
-    void NextBuffer(V4L2Buffer &raw_buffer);
+    void NextBuffer(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer);
 
     LibcameraCapturer &SetFormat(int width, int height);
     LibcameraCapturer &SetFps(int fps);
@@ -59,6 +66,10 @@ class LibcameraCapturer : public VideoCapturer {
     void Init(int deviceId);
     void AllocateBuffer();
     void RequestComplete(libcamera::Request *request);
+    void Requeue(libcamera::Request *request);
+    rtc::scoped_refptr<V4L2BufferLease> PackPlanes(libcamera::FrameBuffer *buffer, void *data,
+                                                   timeval timestamp);
+    void CountDroppedFrames(uint32_t sequence);
 };
 
 #endif
@@ -0,0 +1,142 @@
+#include "capturer/motion_detector.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <nlohmann/json.hpp>
+#include <third_party/libyuv/include/libyuv.h>
+
+#include "common/logging.h"
+
+const int ANALYSIS_FPS = 5;
+const int WARMUP_FRAMES = 5;
+// luma difference a pixel needs to count as changed.
+const int PIXEL_THRESHOLD = 24;
+// a change over most of the picture is the light or the ir filter, not an animal.
+const float LIGHTING_CHANGE_AREA = 70.0f;
+
+std::string MotionEvent::ToString() const {
+    nlohmann::json j;
+    j["camera"] = camera;
+    j["active"] = active;
+    j["area"] = area;
+    j["timestamp"] = timestamp_ms;
+    return j.dump();
+}
+
+std::shared_ptr<MotionDetector> MotionDetector::Create(std::shared_ptr<VideoCapturer> capturer,
+                                                       Args args, int camera) {
+    auto ptr = std::make_shared<MotionDetector>(std::move(capturer), args, camera);
+    ptr->Start();
+    return ptr;
+}
+
+MotionDetector::MotionDetector(std::shared_ptr<VideoCapturer> capturer, Args args, int camera)
+    : camera_(camera),
+      width_(std::max(capturer->width() / 8, 2) & ~1),
+      height_(std::max(capturer->height() / 8, 2) & ~1),
+      area_threshold_(args.motion_area),
+      idle_fps_(args.idle_fps),
+      hold_ms_(args.motion_hold * rtc::kNumMillisecsPerSec),
+      warmup_frames_(WARMUP_FRAMES),
+      last_analysis_ms_(0),
+      last_motion_ms_(0),
+      is_active_(false),
+      luma_(width_ * height_),
+      background_(width_ * height_),
+      capturer_(std::move(capturer)) {}
+
+MotionDetector::~MotionDetector() {
+    observer_.reset();
+    capturer_->SetFrameRateLimit(0);
+}
+
+bool MotionDetector::IsActive() const { return is_active_.load(); }
+
+void MotionDetector::Start() {
+    capturer_->SetFrameRateLimit(idle_fps_);
+
+    // a few small frames per second are cheap enough to analyze on the capture thread.
+    observer_ = capturer_->AsFrameBufferObservable();
+    observer_->Subscribe([this](rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+        OnFrame(frame_buffer);
+    });
+}
+
+void MotionDetector::OnFrame(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+    int64_t now_ms = rtc::TimeMillis();
+    if (now_ms - last_analysis_ms_ < rtc::kNumMillisecsPerSec / ANALYSIS_FPS * 4 / 5) {
+        return;
+    }
+    last_analysis_ms_ = now_ms;
+
+    if (!Downscale(frame_buffer)) {
+        return;
+    }
+
+    if (warmup_frames_ > 0) {
+        // let the exposure settle before the background is trusted.
+        for (int i = 0; i < luma_.size(); i++) {
+            background_[i] = luma_[i] << 4;
+        }
+        warmup_frames_--;
+        return;
+    }
+
+    float area = CompareWithBackground();
+    if (area >= LIGHTING_CHANGE_AREA) {
+        DEBUG_PRINT("Camera %d: %.0f%% of the picture changed, relearn the background", camera_,
+                    area);
+        warmup_frames_ = WARMUP_FRAMES;
+        return;
+    }
+
+    if (area >= area_threshold_) {
+        last_motion_ms_ = now_ms;
+        if (!is_active_.load()) {
+            SetActive(true, area);
+        }
+    } else if (is_active_.load() && now_ms - last_motion_ms_ >= hold_ms_) {
+        SetActive(false, area);
+    }
+}
+
+bool MotionDetector::Downscale(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+    if (frame_buffer->format() == V4L2_PIX_FMT_YUV420) {
+        auto *src_y = static_cast<const uint8_t *>(frame_buffer->Data());
+        if (!src_y) {
+            return false;
+        }
+        // the y plane comes first, the chroma planes are not needed.
+        libyuv::ScalePlane(src_y, frame_buffer->width(), frame_buffer->width(),
+                           frame_buffer->height(), luma_.data(), width_, width_, height_,
+                           libyuv::kFilterBox);
+        return true;
+    } else if (frame_buffer->format() == V4L2_PIX_FMT_MJPEG) {
+        // decoded through the jpeg dct scaling straight at the small size.
+        auto i420_buffer = frame_buffer->ToI420(width_, height_);
+        libyuv::CopyPlane(i420_buffer->DataY(), i420_buffer->StrideY(), luma_.data(), width_,
+                          width_, height_);
+        return true;
+    }
+    return false;
+}
+
+float MotionDetector::CompareWithBackground() {
+    int changed = 0;
+    for (int i = 0; i < luma_.size(); i++) {
+        int diff = std::abs(luma_[i] - (background_[i] >> 4));
+        changed += diff > PIXEL_THRESHOLD;
+        // the background follows slow changes, like the daylight, at 1/8 per analyzed frame.
+        background_[i] += ((luma_[i] << 4) - background_[i]) >> 3;
+    }
+    return changed * 100.0f / luma_.size();
+}
+
+void MotionDetector::SetActive(bool active, float area) {
+    is_active_.store(active);
+    capturer_->SetFrameRateLimit(active ? 0 : idle_fps_);
+    INFO_PRINT("Camera %d turns %s (%.1f%% changed)", camera_, active ? "active" : "idle", area);
+
+    Next({camera_, active, area, rtc::TimeUTCMillis()});
+}
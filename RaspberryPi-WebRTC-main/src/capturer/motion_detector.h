@@ -0,0 +1,59 @@
+#ifndef MOTION_DETECTOR_H_
+#define MOTION_DETECTOR_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "args.h"
+#include "capturer/video_capturer.h"
+#include "common/interface/subject.h"
+
+struct MotionEvent {
+    int camera;
+    bool active;
+    // share of the picture that changed, in percent.
+    float area;
+    int64_t timestamp_ms;
+
+    std::string ToString() const;
+};
+
+/* Watches one camera for activity on 1/8 size luma copies of a few frames per second. Each pixel
+ * is compared with a slowly adapting background, and the camera turns active once enough of the
+ * picture differs, then stays active for `motion_hold` seconds after the last motion. While idle
+ * the capturer is slowed down to `idle_fps`. Every change of state is published as an event. */
+class MotionDetector : public Subject<MotionEvent> {
+  public:
+    static std::shared_ptr<MotionDetector> Create(std::shared_ptr<VideoCapturer> capturer,
+                                                  Args args, int camera);
+    MotionDetector(std::shared_ptr<VideoCapturer> capturer, Args args, int camera);
+    ~MotionDetector();
+
+    bool IsActive() const;
+
+  private:
+    int camera_;
+    int width_;
+    int height_;
+    int area_threshold_;
+    int idle_fps_;
+    int64_t hold_ms_;
+    int warmup_frames_;
+    int64_t last_analysis_ms_;
+    int64_t last_motion_ms_;
+    std::atomic<bool> is_active_;
+    std::vector<uint8_t> luma_;
+    std::vector<uint16_t> background_;
+    std::shared_ptr<VideoCapturer> capturer_;
+    std::shared_ptr<Observable<rtc::scoped_refptr<V4L2FrameBuffer>>> observer_;
+
+    void Start();
+    void OnFrame(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer);
+    bool Downscale(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer);
+    float CompareWithBackground();
+    void SetActive(bool active, float area);
+};
+
+#endif // MOTION_DETECTOR_H_
@@ -1,9 +1,11 @@
 #include "v4l2_capturer.h"
 
+#include <algorithm>
+
 // Linux
 #include <linux/videodev2.h>
 #include <sys/mman.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 
 // WebRTC
 #include <modules/video_capture/video_capture_factory.h>
@@ -22,7 +24,8 @@ std::shared_ptr<V4L2Capturer> V4L2Capturer::Create(Args args) {
 }
 
 V4L2Capturer::V4L2Capturer(Args args)
-    : buffer_count_(4),
+    : buffer_count_(args.capture_buffers),
+      max_buffer_count_(std::max(args.capture_buffers, 12)),
       hw_accel_(args.hw_accel),
       format_(args.format),
       has_first_keyframe_(false),
@@ -38,10 +41,12 @@ void V4L2Capturer::Init(int deviceId) {
 }
 
 V4L2Capturer::~V4L2Capturer() {
-    worker_.reset();
+    if (reactor_) {
+        reactor_->Unregister(fd_);
+    }
     decoder_.reset();
-    V4L2Util::StreamOff(fd_, capture_.type);
-    V4L2Util::DeallocateBuffer(fd_, &capture_);
+    // frames still held by consumers keep the pool, and its buffers, alive.
+    pool_.reset();
     V4L2Util::CloseDevice(fd_);
 }
 
@@ -95,8 +100,11 @@ V4L2Capturer &V4L2Capturer::SetFormat(int width, int height) {
     if (format_ == V4L2_PIX_FMT_H264) {
         V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_BITRATE_MODE,
                              V4L2_MPEG_VIDEO_BITRATE_MODE_VBR);
+        // forwarded streams have to match the constrained baseline profile offered in the sdp.
         V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_PROFILE,
-                             V4L2_MPEG_VIDEO_H264_PROFILE_HIGH);
+                             config_.h264_passthrough
+                                 ? V4L2_MPEG_VIDEO_H264_PROFILE_CONSTRAINED_BASELINE
+                                 : V4L2_MPEG_VIDEO_H264_PROFILE_HIGH);
         V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_REPEAT_SEQ_HEADER, true);
         V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_LEVEL, V4L2_MPEG_VIDEO_H264_LEVEL_4_0);
         V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_I_PERIOD, 60); /* trick */
@@ -122,44 +130,33 @@ V4L2Capturer &V4L2Capturer::SetRotation(int angle) {
 }
 
 void V4L2Capturer::CaptureImage() {
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(fd_, &fds);
-    timeval tv = {};
-    tv.tv_sec = 0;
-    tv.tv_usec = 200000;
-    int r = select(fd_ + 1, &fds, NULL, NULL, &tv);
-    if (r == -1) {
-        ERROR_PRINT("select failed");
-        return;
-    } else if (r == 0) { // timeout
-        DEBUG_PRINT("capture timeout");
+    auto lease = pool_->Dequeue();
+    if (!lease) {
         return;
     }
 
-    v4l2_buffer buf = {};
-    buf.type = capture_.type;
-    buf.memory = capture_.memory;
-
-    if (!V4L2Util::DequeueBuffer(fd_, &buf)) {
-        return;
-    }
-
-    V4L2Buffer buffer((uint8_t *)capture_.buffers[buf.index].start, buf.bytesused, buf.flags,
-                      buf.timestamp);
-    NextBuffer(buffer);
-
-    if (!V4L2Util::QueueBuffer(fd_, &buf)) {
-        return;
-    }
+    // the buffer goes back to the driver once the last frame referring to it is released.
+    NextBuffer(lease);
 }
 
 rtc::scoped_refptr<webrtc::I420BufferInterface> V4L2Capturer::GetI420Frame() {
     return frame_buffer_->ToI420();
 }
 
-void V4L2Capturer::NextBuffer(V4L2Buffer &buffer) {
-    if (hw_accel_) {
+void V4L2Capturer::RequestKeyFrame() {
+    if (format_ == V4L2_PIX_FMT_H264) {
+        V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME, 1);
+    }
+}
+
+void V4L2Capturer::NextBuffer(rtc::scoped_refptr<V4L2BufferLease> lease) {
+    V4L2Buffer buffer = lease->buffer();
+    auto raw_buffer = V4L2FrameBuffer::Create(width_, height_, lease, format_);
+
+    if (config_.h264_passthrough) {
+        // peers forward the raw access units, nothing needs decoding.
+        frame_buffer_ = raw_buffer;
+    } else if (hw_accel_) {
         // hardware encoding
         if (!has_first_keyframe_) {
             has_first_keyframe_ = (buffer.flags & V4L2_BUF_FLAG_KEYFRAME) != 0;
@@ -172,13 +169,13 @@ void V4L2Capturer::NextBuffer(V4L2Buffer &buffer) {
                 NextFrameBuffer(frame_buffer_);
             });
         } else {
-            frame_buffer_ = V4L2FrameBuffer::Create(width_, height_, buffer, format_);
+            frame_buffer_ = raw_buffer;
             NextFrameBuffer(frame_buffer_);
         }
     } else {
         // software decoding
         if (format_ != V4L2_PIX_FMT_H264) {
-            frame_buffer_ = V4L2FrameBuffer::Create(width_, height_, buffer, format_);
+            frame_buffer_ = raw_buffer;
             NextFrameBuffer(frame_buffer_);
         } else {
             // todo: h264 decoding
@@ -187,23 +184,21 @@ void V4L2Capturer::NextBuffer(V4L2Buffer &buffer) {
         }
     }
 
-    NextRawBuffer(buffer);
+    NextRawBuffer(raw_buffer);
 }
 
 void V4L2Capturer::StartCapture() {
-    if (!V4L2Util::AllocateBuffer(fd_, &capture_, buffer_count_) ||
-        !V4L2Util::QueueBuffers(fd_, &capture_)) {
+    pool_ = V4L2BufferPool::Create(fd_, capture_, buffer_count_, max_buffer_count_);
+    if (!pool_) {
         exit(0);
     }
 
-    V4L2Util::StreamOn(fd_, capture_.type);
-
-    if (hw_accel_ && IsCompressedFormat()) {
+    if (hw_accel_ && IsCompressedFormat() && !config_.h264_passthrough) {
         decoder_ = V4L2Decoder::Create(config_.width, config_.height, format_, true);
     }
 
-    worker_ = std::make_unique<Worker>("V4L2Capture", [this]() {
+    reactor_ = V4L2Reactor::Shared();
+    reactor_->Register(fd_, EPOLLIN, [this](uint32_t events) {
         CaptureImage();
     });
-    worker_->Run();
 }
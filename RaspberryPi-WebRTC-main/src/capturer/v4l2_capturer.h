@@ -7,9 +7,10 @@
 #include "capturer/video_capturer.h"
 #include "codecs/v4l2/v4l2_decoder.h"
 #include "common/interface/subject.h"
+#include "common/v4l2_buffer_pool.h"
 #include "common/v4l2_frame_buffer.h"
+#include "common/v4l2_reactor.h"
 #include "common/v4l2_utils.h"
-#include "common/worker.h"
 
 class V4L2Capturer : public VideoCapturer {
   public:
@@ -25,6 +26,7 @@ class V4L2Capturer : public VideoCapturer {
     Args config() const override;
     void StartCapture() override;
     rtc::scoped_refptr<webrtc::I420BufferInterface> GetI420Frame() override;
+    void RequestKeyFrame() override;
 
   private:
     int fd_;
@@ -32,16 +34,18 @@ class V4L2Capturer : public VideoCapturer {
     int width_;
     int height_;
     int buffer_count_;
+    int max_buffer_count_;
     bool hw_accel_;
     bool has_first_keyframe_;
     uint32_t format_;
     Args config_;
     V4L2BufferGroup capture_;
-    std::unique_ptr<Worker> worker_;
+    std::shared_ptr<V4L2BufferPool> pool_;
+    std::shared_ptr<V4L2Reactor> reactor_;
     std::unique_ptr<V4L2Decoder> decoder_;
 
     rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer_;
-    void NextBuffer(V4L2Buffer &raw_buffer);
+    void NextBuffer(rtc::scoped_refptr<V4L2BufferLease> lease);
 
     V4L2Capturer &SetFormat(int width, int height);
     V4L2Capturer &SetFps(int fps = 30);
@@ -1,11 +1,14 @@
 #ifndef VIDEO_CAPTURER_H_
 #define VIDEO_CAPTURER_H_
 
+#include <atomic>
+
 #include "args.h"
 #include "common/interface/subject.h"
 #include "common/v4l2_frame_buffer.h"
 #include "common/v4l2_utils.h"
 #include <modules/video_capture/video_capture.h>
+#include <rtc_base/time_utils.h>
 
 class VideoCapturer {
   public:
@@ -25,8 +28,14 @@ class VideoCapturer {
     virtual rtc::scoped_refptr<webrtc::I420BufferInterface> GetI420Frame() = 0;
 
     virtual VideoCapturer &SetControls(const int key, const int value) { return *this; };
+    virtual void RequestKeyFrame(){};
+    /* Delivers at most `fps` frames per second to the consumers, 0 restores the capture rate.
+     * Inter coded h264 from the camera is never thinned out, every frame is a reference. */
+    virtual void SetFrameRateLimit(int fps) {
+        frame_interval_us_.store(fps > 0 ? rtc::kNumMicrosecsPerSec / fps : 0);
+    }
 
-    std::shared_ptr<Observable<V4L2Buffer>> AsRawBufferObservable() {
+    std::shared_ptr<Observable<rtc::scoped_refptr<V4L2FrameBuffer>>> AsRawBufferObservable() {
         return raw_buffer_subject_.AsObservable();
     }
 
@@ -34,15 +43,47 @@ class VideoCapturer {
         return frame_buffer_subject_.AsObservable();
     }
 
+    // Frames each frame buffer consumer, then each raw buffer consumer, dropped by falling behind.
+    std::vector<uint64_t> DroppedFrames() {
+        auto dropped = frame_buffer_subject_.dropped();
+        auto raw_dropped = raw_buffer_subject_.dropped();
+        dropped.insert(dropped.end(), raw_dropped.begin(), raw_dropped.end());
+        return dropped;
+    }
+
   protected:
-    void NextRawBuffer(V4L2Buffer raw_buffer) { raw_buffer_subject_.Next(raw_buffer); }
+    void NextRawBuffer(rtc::scoped_refptr<V4L2FrameBuffer> raw_buffer) {
+        if (format() == V4L2_PIX_FMT_H264 || IsFrameDue(last_raw_buffer_us_)) {
+            raw_buffer_subject_.Next(raw_buffer);
+        }
+    }
 
     void NextFrameBuffer(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
-        frame_buffer_subject_.Next(frame_buffer);
+        if (IsFrameDue(last_frame_buffer_us_)) {
+            frame_buffer_subject_.Next(frame_buffer);
+        }
     }
 
   private:
-    Subject<V4L2Buffer> raw_buffer_subject_;
+    std::atomic<int64_t> frame_interval_us_{0};
+    int64_t last_raw_buffer_us_ = 0;
+    int64_t last_frame_buffer_us_ = 0;
+
+    bool IsFrameDue(int64_t &last_us) {
+        int64_t interval_us = frame_interval_us_.load();
+        if (interval_us == 0) {
+            return true;
+        }
+        // some slack, so capture jitter does not skip a frame that is just early.
+        int64_t now_us = rtc::TimeMicros();
+        if (now_us - last_us < interval_us * 4 / 5) {
+            return false;
+        }
+        last_us = now_us;
+        return true;
+    }
+
+    Subject<rtc::scoped_refptr<V4L2FrameBuffer>> raw_buffer_subject_;
     Subject<rtc::scoped_refptr<V4L2FrameBuffer>> frame_buffer_subject_;
 };
 
@@ -0,0 +1,177 @@
+#include "codecs/h264/h264_passthrough_encoder.h"
+
+#include <cstring>
+
+// WebRTC
+#include <common_video/h264/h264_common.h>
+
+#include "common/logging.h"
+#include "common/v4l2_frame_buffer.h"
+
+static const uint8_t kStartCode[] = {0, 0, 0, 1};
+
+std::unique_ptr<webrtc::VideoEncoder>
+H264PassthroughEncoder::Create(std::function<void()> request_key_frame) {
+    return std::make_unique<H264PassthroughEncoder>(std::move(request_key_frame));
+}
+
+H264PassthroughEncoder::H264PassthroughEncoder(std::function<void()> request_key_frame)
+    : width_(0),
+      height_(0),
+      has_key_frame_(false),
+      request_key_frame_(std::move(request_key_frame)),
+      callback_(nullptr) {}
+
+int32_t H264PassthroughEncoder::InitEncode(const webrtc::VideoCodec *codec_settings,
+                                           const VideoEncoder::Settings &settings) {
+    width_ = codec_settings->width;
+    height_ = codec_settings->height;
+
+    encoded_image_.timing_.flags = webrtc::VideoSendTiming::TimingFrameFlags::kInvalid;
+    encoded_image_.content_type_ = webrtc::VideoContentType::UNSPECIFIED;
+
+    if (codec_settings->codecType != webrtc::kVideoCodecH264) {
+        return WEBRTC_VIDEO_CODEC_ERROR;
+    }
+
+    // the new peer can only start decoding from an idr.
+    has_key_frame_ = false;
+    request_key_frame_();
+
+    return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t
+H264PassthroughEncoder::RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback *callback) {
+    callback_ = callback;
+    return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t H264PassthroughEncoder::Release() { return WEBRTC_VIDEO_CODEC_OK; }
+
+int32_t H264PassthroughEncoder::Encode(const webrtc::VideoFrame &frame,
+                                       const std::vector<webrtc::VideoFrameType> *frame_types) {
+    if (frame_types) {
+        if ((*frame_types)[0] == webrtc::VideoFrameType::kVideoFrameKey) {
+            request_key_frame_();
+        } else if ((*frame_types)[0] == webrtc::VideoFrameType::kEmptyFrame) {
+            return WEBRTC_VIDEO_CODEC_OK;
+        }
+    }
+
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame_buffer = frame.video_frame_buffer();
+    if (frame_buffer->type() != webrtc::VideoFrameBuffer::Type::kNative) {
+        ERROR_PRINT("The h264 pass-through needs the camera's own buffers.");
+        return WEBRTC_VIDEO_CODEC_ERROR;
+    }
+    V4L2FrameBuffer *raw_buffer = static_cast<V4L2FrameBuffer *>(frame_buffer.get());
+    if (raw_buffer->format() != V4L2_PIX_FMT_H264) {
+        ERROR_PRINT("The h264 pass-through needs a camera that outputs h264.");
+        return WEBRTC_VIDEO_CODEC_ERROR;
+    }
+
+    bool is_idr = false;
+    auto encoded_image_buffer = FixUpAccessUnit(static_cast<const uint8_t *>(raw_buffer->Data()),
+                                                raw_buffer->size(), &is_idr);
+    if (!has_key_frame_ && !is_idr) {
+        // delta frames before the first idr cannot be decoded.
+        return WEBRTC_VIDEO_CODEC_OK;
+    }
+    has_key_frame_ = true;
+
+    webrtc::CodecSpecificInfo codec_specific;
+    codec_specific.codecType = webrtc::kVideoCodecH264;
+    codec_specific.codecSpecific.H264.packetization_mode =
+        webrtc::H264PacketizationMode::NonInterleaved;
+
+    encoded_image_.SetEncodedData(encoded_image_buffer);
+    encoded_image_.SetTimestamp(frame.timestamp());
+    encoded_image_.SetColorSpace(frame.color_space());
+    encoded_image_._encodedWidth = raw_buffer->width();
+    encoded_image_._encodedHeight = raw_buffer->height();
+    encoded_image_.capture_time_ms_ = frame.render_time_ms();
+    encoded_image_.ntp_time_ms_ = frame.ntp_time_ms();
+    encoded_image_.rotation_ = frame.rotation();
+    encoded_image_._frameType = is_idr ? webrtc::VideoFrameType::kVideoFrameKey
+                                       : webrtc::VideoFrameType::kVideoFrameDelta;
+
+    auto result = callback_->OnEncodedImage(encoded_image_, &codec_specific);
+    if (result.error != webrtc::EncodedImageCallback::Result::OK) {
+        ERROR_PRINT("Failed to send the frame => %d", result.error);
+    }
+
+    return WEBRTC_VIDEO_CODEC_OK;
+}
+
+rtc::scoped_refptr<webrtc::EncodedImageBuffer>
+H264PassthroughEncoder::FixUpAccessUnit(const uint8_t *data, size_t size, bool *is_idr) {
+    auto nalus = webrtc::H264::FindNaluIndices(data, size);
+
+    bool has_parameter_sets = false;
+    std::vector<uint8_t> parameter_sets;
+    size_t total_size = 0;
+    for (auto &nalu : nalus) {
+        auto type = webrtc::H264::ParseNaluType(data[nalu.payload_start_offset]);
+        if (type == webrtc::H264::NaluType::kAud) {
+            // access unit delimiters carry nothing over rtp.
+            continue;
+        }
+        if (type == webrtc::H264::NaluType::kIdr) {
+            *is_idr = true;
+        } else if (type == webrtc::H264::NaluType::kSps || type == webrtc::H264::NaluType::kPps) {
+            has_parameter_sets = true;
+            parameter_sets.insert(parameter_sets.end(), kStartCode,
+                                  kStartCode + sizeof(kStartCode));
+            parameter_sets.insert(parameter_sets.end(), data + nalu.payload_start_offset,
+                                  data + nalu.payload_start_offset + nalu.payload_size);
+        }
+        total_size += sizeof(kStartCode) + nalu.payload_size;
+    }
+
+    if (has_parameter_sets) {
+        parameter_sets_ = std::move(parameter_sets);
+    }
+    // peers joining on this idr need the sps/pps in front of it.
+    bool prepend_parameter_sets = *is_idr && !has_parameter_sets;
+    if (prepend_parameter_sets) {
+        total_size += parameter_sets_.size();
+    }
+
+    auto encoded_image_buffer = webrtc::EncodedImageBuffer::Create(total_size);
+    uint8_t *dst = encoded_image_buffer->data();
+    if (prepend_parameter_sets) {
+        memcpy(dst, parameter_sets_.data(), parameter_sets_.size());
+        dst += parameter_sets_.size();
+    }
+    for (auto &nalu : nalus) {
+        if (webrtc::H264::ParseNaluType(data[nalu.payload_start_offset]) ==
+            webrtc::H264::NaluType::kAud) {
+            continue;
+        }
+        memcpy(dst, kStartCode, sizeof(kStartCode));
+        memcpy(dst + sizeof(kStartCode), data + nalu.payload_start_offset, nalu.payload_size);
+        dst += sizeof(kStartCode) + nalu.payload_size;
+    }
+
+    return encoded_image_buffer;
+}
+
+void H264PassthroughEncoder::SetRates(const RateControlParameters &parameters) {
+    // the camera keeps its own rate control. While paused, frames are dropped ahead of this
+    // encoder, so the stream resumes on an idr.
+    if (parameters.bitrate.get_sum_bps() <= 0) {
+        has_key_frame_ = false;
+    } else if (!has_key_frame_) {
+        request_key_frame_();
+    }
+}
+
+webrtc::VideoEncoder::EncoderInfo H264PassthroughEncoder::GetEncoderInfo() const {
+    EncoderInfo info;
+    info.supports_native_handle = true;
+    info.is_hardware_accelerated = true;
+    // dropping a frame ahead of the "encoder" would break the references of the next ones.
+    info.has_trusted_rate_controller = true;
+    info.implementation_name = "H264 Passthrough";
+    return info;
+}
@@ -0,0 +1,40 @@
+#ifndef H264_PASSTHROUGH_ENCODER_H_
+#define H264_PASSTHROUGH_ENCODER_H_
+
+#include <functional>
+#include <vector>
+
+#include <api/video_codecs/video_encoder.h>
+#include <modules/video_coding/codecs/h264/include/h264.h>
+
+/* Forwards the access units of a camera that already outputs h264, nothing is decoded or encoded.
+ * Key frame requests go back to the camera, and delta frames are held back until the first idr. */
+class H264PassthroughEncoder : public webrtc::VideoEncoder {
+  public:
+    static std::unique_ptr<webrtc::VideoEncoder>
+    Create(std::function<void()> request_key_frame);
+    H264PassthroughEncoder(std::function<void()> request_key_frame);
+
+    int32_t InitEncode(const webrtc::VideoCodec *codec_settings,
+                       const VideoEncoder::Settings &settings) override;
+    int32_t RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback *callback) override;
+    int32_t Release() override;
+    int32_t Encode(const webrtc::VideoFrame &frame,
+                   const std::vector<webrtc::VideoFrameType> *frame_types) override;
+    void SetRates(const RateControlParameters &parameters) override;
+    webrtc::VideoEncoder::EncoderInfo GetEncoderInfo() const override;
+
+  private:
+    int width_;
+    int height_;
+    bool has_key_frame_;
+    std::function<void()> request_key_frame_;
+    std::vector<uint8_t> parameter_sets_;
+    webrtc::EncodedImage encoded_image_;
+    webrtc::EncodedImageCallback *callback_;
+
+    rtc::scoped_refptr<webrtc::EncodedImageBuffer> FixUpAccessUnit(const uint8_t *data,
+                                                                   size_t size, bool *is_idr);
+};
+
+#endif // H264_PASSTHROUGH_ENCODER_H_
@@ -1,15 +1,19 @@
 #include "codecs/v4l2/v4l2_codec.h"
 #include "common/logging.h"
 #include <cstring>
-#include <thread>
+#include <sys/epoll.h>
 
 V4L2Codec::V4L2Codec()
     : fd_(0),
-      abort_(false) {}
+      abort_(false),
+      output_buffer_index_(VIDEO_MAX_FRAME),
+      capturing_tasks_(VIDEO_MAX_FRAME) {}
 
 V4L2Codec::~V4L2Codec() {
     abort_ = true;
-    worker_.reset();
+    if (reactor_) {
+        reactor_->Unregister(fd_);
+    }
     V4L2Util::StreamOff(fd_, output_.type);
     V4L2Util::StreamOff(fd_, capture_.type);
 
@@ -58,10 +62,33 @@ bool V4L2Codec::PrepareBuffer(V4L2BufferGroup *gbuffer, int width, int height, u
 
 void V4L2Codec::Start() {
     abort_ = false;
-    worker_ = std::make_unique<Worker>(file_name_ + std::to_string(pthread_self()), [this]() {
-        CaptureBuffer();
+    reactor_ = V4L2Reactor::Shared();
+    reactor_->Register(fd_, EPOLLIN | EPOLLPRI, [this](uint32_t events) {
+        OnReady(events);
     });
-    worker_->Run();
+}
+
+void V4L2Codec::Restart() {
+    abort_ = true;
+    if (reactor_) {
+        reactor_->Unregister(fd_);
+    }
+
+    V4L2Util::StreamOff(fd_, output_.type);
+    V4L2Util::StreamOff(fd_, capture_.type);
+
+    while (output_buffer_index_.pop()) {
+    }
+    while (capturing_tasks_.pop()) {
+    }
+    for (int i = 0; i < output_.num_buffers; i++) {
+        output_buffer_index_.push(i);
+    }
+    V4L2Util::QueueBuffers(fd_, &capture_);
+
+    V4L2Util::StreamOn(fd_, output_.type);
+    V4L2Util::StreamOn(fd_, capture_.type);
+    Start();
 }
 
 void V4L2Codec::EmplaceBuffer(V4L2Buffer &buffer, std::function<void(V4L2Buffer &)> on_capture) {
@@ -87,80 +114,63 @@ void V4L2Codec::EmplaceBuffer(V4L2Buffer &buffer, std::function<void(V4L2Buffer
         return;
     }
 
-    capturing_tasks_.push(on_capture);
+    capturing_tasks_.push(std::move(on_capture));
 }
 
-bool V4L2Codec::CaptureBuffer() {
-
+void V4L2Codec::OnReady(uint32_t events) {
     if (abort_) {
-        return false;
+        return;
     }
 
-    fd_set fds[2];
-    fd_set *rd_fds = &fds[0]; /* for capture */
-    fd_set *ex_fds = &fds[1]; /* for handle event */
-    FD_ZERO(rd_fds);
-    FD_SET(fd_, rd_fds);
-    FD_ZERO(ex_fds);
-    FD_SET(fd_, ex_fds);
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 200000;
+    if (events & EPOLLIN) {
+        CaptureBuffer();
+    }
 
-    int r = select(fd_ + 1, rd_fds, NULL, ex_fds, &tv);
+    if (events & EPOLLPRI) {
+        ERROR_PRINT("Exception in fd(%d).", fd_);
+        HandleEvent();
+    }
+}
 
-    if (abort_) {
+bool V4L2Codec::CaptureBuffer() {
+    struct v4l2_buffer buf = {0};
+    struct v4l2_plane planes = {0};
+    buf.memory = output_.memory;
+    buf.length = 1;
+    buf.m.planes = &planes;
+    buf.type = output_.type;
+    if (!V4L2Util::DequeueBuffer(fd_, &buf)) {
         return false;
-    } else if (r <= 0) { // failed or timeout
+    }
+    output_buffer_index_.push(buf.index);
+
+    buf = {};
+    planes = {};
+    buf.memory = capture_.memory;
+    buf.length = 1;
+    buf.m.planes = &planes;
+    buf.type = capture_.type;
+    if (!V4L2Util::DequeueBuffer(fd_, &buf)) {
         return false;
     }
 
-    if (rd_fds && FD_ISSET(fd_, rd_fds)) {
-        struct v4l2_buffer buf = {0};
-        struct v4l2_plane planes = {0};
-        buf.memory = output_.memory;
-        buf.length = 1;
-        buf.m.planes = &planes;
-        buf.type = output_.type;
-        if (!V4L2Util::DequeueBuffer(fd_, &buf)) {
-            return false;
-        }
-        output_buffer_index_.push(buf.index);
-
-        buf = {};
-        planes = {};
-        buf.memory = capture_.memory;
-        buf.length = 1;
-        buf.m.planes = &planes;
-        buf.type = capture_.type;
-        if (!V4L2Util::DequeueBuffer(fd_, &buf)) {
-            return false;
-        }
-
-        V4L2Buffer buffer;
-        buffer.start = capture_.buffers[buf.index].start;
-        buffer.length = buf.m.planes[0].bytesused;
-        buffer.dmafd = capture_.buffers[buf.index].dmafd;
-        buffer.flags = buf.flags;
-
-        if (abort_) {
-            return false;
-        }
+    V4L2Buffer buffer;
+    buffer.start = capture_.buffers[buf.index].start;
+    buffer.length = buf.m.planes[0].bytesused;
+    buffer.dmafd = capture_.buffers[buf.index].dmafd;
+    buffer.flags = buf.flags;
 
-        auto item = capturing_tasks_.pop();
-        if (item) {
-            auto task = item.value();
-            task(buffer);
-        }
+    if (abort_) {
+        return false;
+    }
 
-        if (!V4L2Util::QueueBuffer(fd_, &capture_.buffers[buf.index].inner)) {
-            return false;
-        }
+    auto item = capturing_tasks_.pop();
+    if (item) {
+        (*item)(buffer);
     }
 
-    if (ex_fds && FD_ISSET(fd_, ex_fds)) {
-        ERROR_PRINT("Exception in fd(%d).", fd_);
-        HandleEvent();
+    if (!V4L2Util::QueueBuffer(fd_, &capture_.buffers[buf.index].inner)) {
+        return false;
     }
 
     return true;
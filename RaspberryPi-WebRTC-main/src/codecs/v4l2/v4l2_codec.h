@@ -1,9 +1,9 @@
 #ifndef V4L2_CODEC_
 #define V4L2_CODEC_
 
-#include "common/thread_safe_queue.h"
+#include "common/lock_free_queue.h"
+#include "common/v4l2_reactor.h"
 #include "common/v4l2_utils.h"
-#include "common/worker.h"
 
 class V4L2Codec {
   public:
@@ -22,13 +22,16 @@ class V4L2Codec {
                        v4l2_buf_type type, v4l2_memory memory, int buffer_num,
                        bool has_dmafd = false);
     void Start();
+    // Streams off and on again, pending buffers and their callbacks are dropped.
+    void Restart();
 
   private:
     std::atomic<bool> abort_;
-    std::unique_ptr<Worker> worker_;
-    ThreadSafeQueue<int> output_buffer_index_;
-    ThreadSafeQueue<std::function<void(V4L2Buffer &)>> capturing_tasks_;
+    std::shared_ptr<V4L2Reactor> reactor_;
+    MpmcQueue<int> output_buffer_index_;
+    MpmcQueue<std::function<void(V4L2Buffer &)>> capturing_tasks_;
     const char *file_name_;
+    void OnReady(uint32_t events);
     bool CaptureBuffer();
 };
 
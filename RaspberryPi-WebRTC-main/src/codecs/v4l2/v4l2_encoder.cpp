@@ -4,36 +4,58 @@
 const char *ENCODER_FILE = "/dev/video11";
 const int BUFFER_NUM = 4;
 const int KEY_FRAME_INTERVAL = 600;
+const int MIN_BITRATE_BPS = 100000;
+const int BITRATE_STEP_BPS = 25000;
+const int H264_MIN_QP = 0;
+const int H264_MAX_QP = 51;
 
-std::unique_ptr<V4L2Encoder> V4L2Encoder::Create(int width, int height, bool is_dma_src) {
+std::unique_ptr<V4L2Encoder> V4L2Encoder::Create(int width, int height, bool is_dma_src,
+                                                 int profile) {
     auto encoder = std::make_unique<V4L2Encoder>();
-    encoder->Configure(width, height, is_dma_src);
+    if (!encoder->Configure(width, height, is_dma_src, profile)) {
+        return nullptr;
+    }
     encoder->Start();
     return encoder;
 }
 
 V4L2Encoder::V4L2Encoder()
     : V4L2Codec(),
+      width_(0),
+      height_(0),
+      is_dma_src_(false),
+      profile_(V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE),
       framerate_(30),
-      bitrate_bps_(10000000) {}
+      bitrate_bps_(10000000),
+      bitrate_mode_(-1),
+      min_qp_(0),
+      max_qp_(0),
+      gop_(-1),
+      intra_refresh_mb_(-1) {}
+
+bool V4L2Encoder::Configure(int width, int height, bool is_dma_src, int profile) {
+    width_ = width;
+    height_ = height;
+    is_dma_src_ = is_dma_src;
+    profile_ = profile;
 
-bool V4L2Encoder::Configure(int width, int height, bool is_dma_src) {
     if (!Open(ENCODER_FILE)) {
         DEBUG_PRINT("Failed to turn on encoder: %s", ENCODER_FILE);
         return false;
     }
 
-    V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_REPEAT_SEQ_HEADER, true);
-    V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_PROFILE,
-                         V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE);
-    V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_LEVEL, V4L2_MPEG_VIDEO_H264_LEVEL_4_0);
-    V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_I_PERIOD, KEY_FRAME_INTERVAL);
+    // the profile cannot change while streaming, so it is fixed for the session.
+    V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_PROFILE, profile_);
+    SetDefaultControls();
 
     auto src_memory = is_dma_src ? V4L2_MEMORY_DMABUF : V4L2_MEMORY_MMAP;
-    PrepareBuffer(&output_, width, height, V4L2_PIX_FMT_YUV420, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
-                  src_memory, BUFFER_NUM);
-    PrepareBuffer(&capture_, width, height, V4L2_PIX_FMT_H264, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
-                  V4L2_MEMORY_MMAP, BUFFER_NUM);
+    if (!PrepareBuffer(&output_, width, height, V4L2_PIX_FMT_YUV420,
+                       V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, src_memory, BUFFER_NUM) ||
+        !PrepareBuffer(&capture_, width, height, V4L2_PIX_FMT_H264,
+                       V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, V4L2_MEMORY_MMAP, BUFFER_NUM)) {
+        ERROR_PRINT("Failed to prepare the encoder buffers for %dx%d", width, height);
+        return false;
+    }
 
     V4L2Util::StreamOn(fd_, output_.type);
     V4L2Util::StreamOn(fd_, capture_.type);
@@ -41,11 +63,85 @@ bool V4L2Encoder::Configure(int width, int height, bool is_dma_src) {
     return true;
 }
 
+void V4L2Encoder::SetDefaultControls() {
+    V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_REPEAT_SEQ_HEADER, true);
+    V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_LEVEL, V4L2_MPEG_VIDEO_H264_LEVEL_4_0);
+    SetBitrateMode(V4L2_MPEG_VIDEO_BITRATE_MODE_VBR);
+    if (min_qp_ > 0 || max_qp_ > 0) {
+        V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_MIN_QP, H264_MIN_QP);
+        V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_MAX_QP, H264_MAX_QP);
+        min_qp_ = max_qp_ = 0;
+    }
+    SetGop(KEY_FRAME_INTERVAL);
+    SetIntraRefresh(0);
+}
+
+void V4L2Encoder::Reset() {
+    Restart();
+    SetDefaultControls();
+    V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME, 1);
+}
+
+void V4L2Encoder::SetControls(const Args &args) {
+    SetBitrateMode(args.v4l2_bitrate_mode);
+    SetQpRange(args.min_qp, args.max_qp);
+    SetIntraRefresh(args.intra_refresh);
+    SetGop(args.intra_refresh > 0 ? 0 : args.key_frame_interval);
+}
+
+void V4L2Encoder::SetBitrateMode(int mode) {
+    if (bitrate_mode_ == mode) {
+        return;
+    }
+    // only a mode the driver took is kept, SetBitrate() relies on the actual one.
+    if (!V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_BITRATE_MODE, mode)) {
+        ERROR_PRINT("Bitrate mode %d is not supported by the encoder, keep mode %d", mode,
+                    bitrate_mode_);
+        return;
+    }
+    bitrate_mode_ = mode;
+}
+
+void V4L2Encoder::SetQpRange(int min_qp, int max_qp) {
+    if (min_qp > 0 && min_qp_ != min_qp) {
+        min_qp_ = min_qp;
+        V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_MIN_QP, min_qp_);
+    }
+    if (max_qp > 0 && max_qp_ != max_qp) {
+        max_qp_ = max_qp;
+        V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_MAX_QP, max_qp_);
+    }
+}
+
+void V4L2Encoder::SetGop(int frames) {
+    if (gop_ != frames) {
+        gop_ = frames;
+        if (!V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_H264_I_PERIOD, gop_)) {
+            DEBUG_PRINT("Failed to set gop: %d frames", gop_);
+        }
+    }
+}
+
+void V4L2Encoder::SetIntraRefresh(int macroblocks) {
+    if (intra_refresh_mb_ != macroblocks) {
+        intra_refresh_mb_ = macroblocks;
+        if (!V4L2Util::SetExtCtrl(fd_, V4L2_CID_MPEG_VIDEO_CYCLIC_INTRA_REFRESH_MB,
+                                  intra_refresh_mb_)) {
+            DEBUG_PRINT("Failed to set intra refresh: %d macroblocks", intra_refresh_mb_);
+        }
+    }
+}
+
 void V4L2Encoder::SetBitrate(uint32_t adjusted_bitrate_bps) {
-    if (adjusted_bitrate_bps < 1000000) {
-        adjusted_bitrate_bps = 1000000;
+    if (bitrate_mode_ == V4L2_MPEG_VIDEO_BITRATE_MODE_CQ) {
+        // the quantizer alone decides the size of each frame.
+        return;
+    }
+
+    if (adjusted_bitrate_bps < MIN_BITRATE_BPS) {
+        adjusted_bitrate_bps = MIN_BITRATE_BPS;
     } else {
-        adjusted_bitrate_bps = (adjusted_bitrate_bps / 25000) * 25000;
+        adjusted_bitrate_bps = (adjusted_bitrate_bps / BITRATE_STEP_BPS) * BITRATE_STEP_BPS;
     }
 
     if (bitrate_bps_ != adjusted_bitrate_bps) {
@@ -66,3 +162,11 @@ void V4L2Encoder::SetFps(int adjusted_fps) {
 }
 
 const int V4L2Encoder::GetFd() const { return fd_; }
+
+int V4L2Encoder::width() const { return width_; }
+
+int V4L2Encoder::height() const { return height_; }
+
+bool V4L2Encoder::is_dma_src() const { return is_dma_src_; }
+
+int V4L2Encoder::profile() const { return profile_; }
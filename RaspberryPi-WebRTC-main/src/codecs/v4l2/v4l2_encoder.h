@@ -1,6 +1,7 @@
 #ifndef V4L2_ENCODER_H_
 #define V4L2_ENCODER_H_
 
+#include "args.h"
 #include "codecs/v4l2/v4l2_codec.h"
 
 #include <api/video_codecs/video_encoder.h>
@@ -8,18 +9,45 @@
 
 class V4L2Encoder : public V4L2Codec {
   public:
-    static std::unique_ptr<V4L2Encoder> Create(int width, int height, bool is_dma_src);
+    static std::unique_ptr<V4L2Encoder>
+    Create(int width, int height, bool is_dma_src,
+           int profile = V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE);
     V4L2Encoder();
 
     void SetBitrate(uint32_t adjusted_bitrate_bps);
     void SetFps(int adjusted_fps);
+    // Rate control mode, qp range, gop and intra refresh as given on the command line.
+    void SetControls(const Args &args);
+    void SetBitrateMode(int mode);
+    // A bound of 0 keeps the encoder's own limit.
+    void SetQpRange(int min_qp, int max_qp);
+    // The idr period in frames, 0 leaves only the first and the requested ones.
+    void SetGop(int frames);
+    // Macroblocks intra coded per frame, spreading the refresh instead of a periodic idr.
+    void SetIntraRefresh(int macroblocks);
     const int GetFd() const;
+    int width() const;
+    int height() const;
+    bool is_dma_src() const;
+    int profile() const;
+    // Warm restart for the next user, the controls go back to their defaults and an idr follows.
+    void Reset();
 
   private:
+    int width_;
+    int height_;
+    bool is_dma_src_;
+    int profile_;
     int framerate_;
     int bitrate_bps_;
+    int bitrate_mode_;
+    int min_qp_;
+    int max_qp_;
+    int gop_;
+    int intra_refresh_mb_;
 
-    bool Configure(int width, int height, bool is_dma_src);
+    bool Configure(int width, int height, bool is_dma_src, int profile);
+    void SetDefaultControls();
 };
 
 #endif // V4L2_ENCODER_H_
@@ -0,0 +1,101 @@
+#include "codecs/v4l2/v4l2_encoder_pool.h"
+#include "common/logging.h"
+
+#include <algorithm>
+
+std::shared_ptr<V4L2EncoderPool> V4L2EncoderPool::Shared() {
+    // a live peer and the recorder, both at their own resolution.
+    static std::shared_ptr<V4L2EncoderPool> pool = std::make_shared<V4L2EncoderPool>(2);
+    return pool;
+}
+
+V4L2EncoderPool::V4L2EncoderPool(int max_idle_sessions)
+    : max_idle_sessions_(max_idle_sessions),
+      max_sessions_(0),
+      active_sessions_(0) {}
+
+void V4L2EncoderPool::SetMaxSessions(int max_sessions) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_sessions_ = max_sessions;
+}
+
+V4L2EncoderPool::Session V4L2EncoderPool::Acquire(int width, int height, bool is_dma_src,
+                                                  int profile) {
+    std::unique_ptr<V4L2Encoder> encoder;
+    std::unique_ptr<V4L2Encoder> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::find_if(idle_sessions_.begin(), idle_sessions_.end(),
+                               [&](const std::unique_ptr<V4L2Encoder> &session) {
+                                   return session->width() == width &&
+                                          session->height() == height &&
+                                          session->is_dma_src() == is_dma_src &&
+                                          session->profile() == profile;
+                               });
+        if (it != idle_sessions_.end()) {
+            encoder = std::move(*it);
+            idle_sessions_.erase(it);
+        } else if (max_sessions_ > 0 &&
+                   active_sessions_ + idle_sessions_.size() >= max_sessions_) {
+            if (idle_sessions_.empty()) {
+                ERROR_PRINT("All %d hardware encoder sessions are in use", max_sessions_);
+                return Session(nullptr, Deleter{});
+            }
+            // an idle session holds a hardware context too.
+            evicted = std::move(idle_sessions_.front());
+            idle_sessions_.pop_front();
+        }
+        active_sessions_++;
+    }
+    // free the evicted context before the driver is asked for a new one.
+    evicted.reset();
+
+    if (encoder) {
+        DEBUG_PRINT("Reuse the encoder session %dx%d (%s)", width, height,
+                    is_dma_src ? "DMA" : "MMAP");
+    } else {
+        encoder = V4L2Encoder::Create(width, height, is_dma_src, profile);
+    }
+    if (!encoder) {
+        // the slot was counted above, a session that never opened must not keep it.
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_sessions_--;
+        return Session(nullptr, Deleter{});
+    }
+    return Session(encoder.release(), Deleter{shared_from_this()});
+}
+
+void V4L2EncoderPool::Prewarm(int width, int height, bool is_dma_src, int profile) {
+    Acquire(width, height, is_dma_src, profile);
+}
+
+void V4L2EncoderPool::Release(V4L2Encoder *encoder) {
+    std::unique_ptr<V4L2Encoder> session(encoder);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_sessions_--;
+    }
+    if (session->GetFd() <= 0) {
+        return;
+    }
+    session->Reset();
+
+    // closing a device takes a while, the evicted one is closed outside the lock.
+    std::unique_ptr<V4L2Encoder> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_sessions_.push_back(std::move(session));
+        if (idle_sessions_.size() > max_idle_sessions_) {
+            evicted = std::move(idle_sessions_.front());
+            idle_sessions_.pop_front();
+        }
+    }
+}
+
+void V4L2EncoderPool::Deleter::operator()(V4L2Encoder *encoder) const {
+    if (pool) {
+        pool->Release(encoder);
+    } else {
+        delete encoder;
+    }
+}
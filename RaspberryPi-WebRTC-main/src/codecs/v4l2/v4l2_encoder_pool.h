@@ -0,0 +1,48 @@
+#ifndef V4L2_ENCODER_POOL_H_
+#define V4L2_ENCODER_POOL_H_
+
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "codecs/v4l2/v4l2_encoder.h"
+
+/* Keeps released encoder sessions open, so the next user at the same resolution, source memory and
+ * profile skips opening the device, negotiating formats and mapping buffers. A released session is
+ * restarted with a stream off/on and starts over on an idr. The oldest idle session is closed once
+ * the pool holds too many.
+ * The pool also schedules the hardware for every camera, peer and recorder. With a session limit
+ * set, idle sessions are closed to make room and past the limit Acquire() returns an empty session,
+ * so the caller encodes in software instead of failing in the driver. */
+class V4L2EncoderPool : public std::enable_shared_from_this<V4L2EncoderPool> {
+  public:
+    struct Deleter {
+        std::shared_ptr<V4L2EncoderPool> pool;
+        void operator()(V4L2Encoder *encoder) const;
+    };
+    using Session = std::unique_ptr<V4L2Encoder, Deleter>;
+
+    static std::shared_ptr<V4L2EncoderPool> Shared();
+
+    V4L2EncoderPool(int max_idle_sessions);
+
+    // 0 leaves the number of open sessions to the driver.
+    void SetMaxSessions(int max_sessions);
+
+    Session Acquire(int width, int height, bool is_dma_src,
+                    int profile = V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE);
+    // Opens a session ahead of its first user.
+    void Prewarm(int width, int height, bool is_dma_src,
+                 int profile = V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE);
+
+  private:
+    std::mutex mutex_;
+    int max_idle_sessions_;
+    int max_sessions_;
+    int active_sessions_;
+    std::deque<std::unique_ptr<V4L2Encoder>> idle_sessions_;
+
+    void Release(V4L2Encoder *encoder);
+};
+
+#endif // V4L2_ENCODER_POOL_H_
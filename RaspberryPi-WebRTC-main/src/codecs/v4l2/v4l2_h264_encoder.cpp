@@ -6,9 +6,14 @@ std::unique_ptr<webrtc::VideoEncoder> V4L2H264Encoder::Create(Args args) {
     return std::make_unique<V4L2H264Encoder>(args);
 }
 
+bool V4L2H264Encoder::IsDmaSource(const Args &args) {
+    return !args.fixed_resolution || (args.use_libcamera && args.hw_accel);
+}
+
 V4L2H264Encoder::V4L2H264Encoder(Args args)
-    : fps_adjuster_(args.fps),
-      is_dma_(!args.fixed_resolution),
+    : args_(args),
+      fps_adjuster_(args.fps),
+      is_dma_(IsDmaSource(args)),
       bitrate_adjuster_(.85, 1),
       callback_(nullptr) {}
 
@@ -26,11 +31,25 @@ int32_t V4L2H264Encoder::InitEncode(const webrtc::VideoCodec *codec_settings,
         return WEBRTC_VIDEO_CODEC_ERROR;
     }
 
-    encoder_ = V4L2Encoder::Create(width_, height_, is_dma_);
+    if (!AcquireEncoder()) {
+        return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+    }
 
     return WEBRTC_VIDEO_CODEC_OK;
 }
 
+bool V4L2H264Encoder::AcquireEncoder() {
+    // hand the old session back first, the pool may have no room for both.
+    encoder_.reset();
+    encoder_ = V4L2EncoderPool::Shared()->Acquire(width_, height_, is_dma_,
+                                                  args_.v4l2_h264_profile);
+    if (!encoder_) {
+        return false;
+    }
+    encoder_->SetControls(args_);
+    return true;
+}
+
 int32_t V4L2H264Encoder::RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback *callback) {
     callback_ = callback;
     return WEBRTC_VIDEO_CODEC_OK;
@@ -51,6 +70,25 @@ int32_t V4L2H264Encoder::Encode(const webrtc::VideoFrame &frame,
         }
     }
 
+    V4L2Buffer src_buffer = GetSourceBuffer(frame);
+    if (is_dma_ && src_buffer.dmafd <= 0) {
+        // the frames turned out to be in cpu memory, e.g. libcamera rows repacked for padding.
+        is_dma_ = false;
+        if (!AcquireEncoder()) {
+            return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+        }
+        encoder_->SetFps(fps_adjuster_);
+        encoder_->SetBitrate(bitrate_adjuster_.GetAdjustedBitrateBps());
+    }
+
+    encoder_->EmplaceBuffer(src_buffer, [this, frame](V4L2Buffer encoded_buffer) {
+        SendFrame(frame, encoded_buffer);
+    });
+
+    return WEBRTC_VIDEO_CODEC_OK;
+}
+
+V4L2Buffer V4L2H264Encoder::GetSourceBuffer(const webrtc::VideoFrame &frame) {
     rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame_buffer = frame.video_frame_buffer();
 
     V4L2Buffer src_buffer;
@@ -58,20 +96,16 @@ int32_t V4L2H264Encoder::Encode(const webrtc::VideoFrame &frame,
         V4L2FrameBuffer *raw_buffer = static_cast<V4L2FrameBuffer *>(frame_buffer.get());
         src_buffer = raw_buffer->GetRawBuffer();
     } else {
+        // the planes stay valid as long as the frame, which the capture callback holds.
         auto i420_buffer = frame_buffer->GetI420();
         unsigned int i420_buffer_size =
-            (i420_buffer->StrideY() * height_) +
-            ((i420_buffer->StrideY() + 1) / 2) * ((height_ + 1) / 2) * 2;
+            (i420_buffer->StrideY() * frame.height()) +
+            ((i420_buffer->StrideY() + 1) / 2) * ((frame.height() + 1) / 2) * 2;
 
         src_buffer.start = const_cast<uint8_t *>(i420_buffer->DataY());
         src_buffer.length = i420_buffer_size;
     }
-
-    encoder_->EmplaceBuffer(src_buffer, [this, frame](V4L2Buffer encoded_buffer) {
-        SendFrame(frame, encoded_buffer);
-    });
-
-    return WEBRTC_VIDEO_CODEC_OK;
+    return src_buffer;
 }
 
 void V4L2H264Encoder::SetRates(const RateControlParameters &parameters) {
@@ -97,7 +131,12 @@ webrtc::VideoEncoder::EncoderInfo V4L2H264Encoder::GetEncoderInfo() const {
 void V4L2H264Encoder::SendFrame(const webrtc::VideoFrame &frame, V4L2Buffer &encoded_buffer) {
     auto encoded_image_buffer =
         webrtc::EncodedImageBuffer::Create((uint8_t *)encoded_buffer.start, encoded_buffer.length);
+    SendEncodedImage(frame, encoded_image_buffer, encoded_buffer.flags & V4L2_BUF_FLAG_KEYFRAME);
+}
 
+void V4L2H264Encoder::SendEncodedImage(
+    const webrtc::VideoFrame &frame,
+    rtc::scoped_refptr<webrtc::EncodedImageBuffer> encoded_image_buffer, bool is_key_frame) {
     webrtc::CodecSpecificInfo codec_specific;
     codec_specific.codecType = webrtc::kVideoCodecH264;
     codec_specific.codecSpecific.H264.packetization_mode =
@@ -111,9 +150,8 @@ void V4L2H264Encoder::SendFrame(const webrtc::VideoFrame &frame, V4L2Buffer &enc
     encoded_image_.capture_time_ms_ = frame.render_time_ms();
     encoded_image_.ntp_time_ms_ = frame.ntp_time_ms();
     encoded_image_.rotation_ = frame.rotation();
-    encoded_image_._frameType = encoded_buffer.flags & V4L2_BUF_FLAG_KEYFRAME
-                                    ? webrtc::VideoFrameType::kVideoFrameKey
-                                    : webrtc::VideoFrameType::kVideoFrameDelta;
+    encoded_image_._frameType = is_key_frame ? webrtc::VideoFrameType::kVideoFrameKey
+                                             : webrtc::VideoFrameType::kVideoFrameDelta;
 
     auto result = callback_->OnEncodedImage(encoded_image_, &codec_specific);
     if (result.error != webrtc::EncodedImageCallback::Result::OK) {
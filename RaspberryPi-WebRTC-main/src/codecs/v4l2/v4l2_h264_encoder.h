@@ -7,11 +7,13 @@
 #include <modules/video_coding/codecs/h264/include/h264.h>
 
 #include "args.h"
-#include "codecs/v4l2/v4l2_encoder.h"
+#include "codecs/v4l2/v4l2_encoder_pool.h"
 
 class V4L2H264Encoder : public webrtc::VideoEncoder {
   public:
     static std::unique_ptr<webrtc::VideoEncoder> Create(Args args);
+    // Scaled frames and libcamera buffers arrive as dmabuf, fixed size decoded frames are copied.
+    static bool IsDmaSource(const Args &args);
     V4L2H264Encoder(Args args);
 
     int32_t InitEncode(const webrtc::VideoCodec *codec_settings,
@@ -24,6 +26,7 @@ class V4L2H264Encoder : public webrtc::VideoEncoder {
     webrtc::VideoEncoder::EncoderInfo GetEncoderInfo() const override;
 
   protected:
+    Args args_;
     int width_;
     int height_;
     int fps_adjuster_;
@@ -33,9 +36,14 @@ class V4L2H264Encoder : public webrtc::VideoEncoder {
     webrtc::EncodedImage encoded_image_;
     webrtc::EncodedImageCallback *callback_;
     webrtc::BitrateAdjuster bitrate_adjuster_;
-    std::unique_ptr<V4L2Encoder> encoder_;
+    V4L2EncoderPool::Session encoder_;
 
+    bool AcquireEncoder();
     virtual void SendFrame(const webrtc::VideoFrame &frame, V4L2Buffer &encoded_buffer);
+    void SendEncodedImage(const webrtc::VideoFrame &frame,
+                          rtc::scoped_refptr<webrtc::EncodedImageBuffer> encoded_image_buffer,
+                          bool is_key_frame);
+    static V4L2Buffer GetSourceBuffer(const webrtc::VideoFrame &frame);
 };
 
 #endif
@@ -0,0 +1,102 @@
+#include "codecs/v4l2/v4l2_jpeg_encoder.h"
+#include "common/frame_buffer_pool.h"
+#include "common/logging.h"
+
+#include <cstring>
+#include <future>
+
+#include <third_party/libyuv/include/libyuv.h>
+
+const char *JPEG_ENCODER_FILE = "/dev/video31";
+const int BUFFER_NUM = 2;
+const int ENCODE_TIMEOUT_MS = 1000;
+
+std::unique_ptr<V4L2JpegEncoder> V4L2JpegEncoder::Create(int width, int height, int quality) {
+    auto encoder = std::make_unique<V4L2JpegEncoder>();
+    if (!encoder->Configure(width, height, quality)) {
+        return nullptr;
+    }
+    encoder->Start();
+    return encoder;
+}
+
+V4L2JpegEncoder::V4L2JpegEncoder()
+    : V4L2Codec(),
+      width_(0),
+      height_(0),
+      quality_(0) {}
+
+bool V4L2JpegEncoder::Configure(int width, int height, int quality) {
+    if (!Open(JPEG_ENCODER_FILE)) {
+        DEBUG_PRINT("Failed to turn on jpeg encoder: %s", JPEG_ENCODER_FILE);
+        return false;
+    }
+    width_ = width;
+    height_ = height;
+
+    // snapshots are packed into the encoder's own buffers, see Encode().
+    if (!PrepareBuffer(&output_, width, height, V4L2_PIX_FMT_YUV420,
+                       V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, V4L2_MEMORY_MMAP, BUFFER_NUM) ||
+        !PrepareBuffer(&capture_, width, height, V4L2_PIX_FMT_JPEG,
+                       V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, V4L2_MEMORY_MMAP, BUFFER_NUM)) {
+        return false;
+    }
+    SetQuality(quality);
+
+    V4L2Util::StreamOn(fd_, output_.type);
+    V4L2Util::StreamOn(fd_, capture_.type);
+
+    return true;
+}
+
+void V4L2JpegEncoder::SetQuality(int quality) {
+    if (quality_ != quality) {
+        quality_ = quality;
+        if (!V4L2Util::SetCtrl(fd_, V4L2_CID_JPEG_COMPRESSION_QUALITY, quality_)) {
+            DEBUG_PRINT("Failed to set jpeg quality: %d", quality_);
+        }
+    }
+}
+
+Buffer V4L2JpegEncoder::Encode(const webrtc::I420BufferInterface &i420_buffer, int quality) {
+    if (i420_buffer.width() != width_ || i420_buffer.height() != height_) {
+        ERROR_PRINT("Snapshot size (%dx%d) differs from jpeg encoder (%dx%d)", i420_buffer.width(),
+                    i420_buffer.height(), width_, height_);
+        return {};
+    }
+    SetQuality(quality);
+
+    // the driver takes a packed yuv420 image, whatever strides the source planes have.
+    int chroma_width = (width_ + 1) / 2;
+    int chroma_height = (height_ + 1) / 2;
+    unsigned int size = width_ * height_ + chroma_width * chroma_height * 2;
+    auto packed = FrameDataPool::Shared()->Acquire(size);
+    uint8_t *dst_y = packed.get();
+    uint8_t *dst_u = dst_y + width_ * height_;
+    uint8_t *dst_v = dst_u + chroma_width * chroma_height;
+    libyuv::I420Copy(i420_buffer.DataY(), i420_buffer.StrideY(), i420_buffer.DataU(),
+                     i420_buffer.StrideU(), i420_buffer.DataV(), i420_buffer.StrideV(), dst_y,
+                     width_, dst_u, chroma_width, dst_v, chroma_width, width_, height_);
+
+    // the result outlives this call if the driver answers after the timeout.
+    auto result = std::make_shared<std::promise<Buffer>>();
+    auto encoded = result->get_future();
+    V4L2Buffer src_buffer(packed.get(), size);
+    EmplaceBuffer(src_buffer, [result](V4L2Buffer &encoded_buffer) {
+        Buffer jpeg_buffer;
+        jpeg_buffer.start.reset(static_cast<uint8_t *>(malloc(encoded_buffer.length)));
+        jpeg_buffer.length = encoded_buffer.length;
+        memcpy(jpeg_buffer.start.get(), encoded_buffer.start, encoded_buffer.length);
+        result->set_value(std::move(jpeg_buffer));
+    });
+
+    if (encoded.wait_for(std::chrono::milliseconds(ENCODE_TIMEOUT_MS)) !=
+        std::future_status::ready) {
+        ERROR_PRINT("Jpeg encoder timed out");
+        // the stale callback would answer the next request, and a frame the driver dropped
+        // never gives its output buffer back.
+        Restart();
+        return {};
+    }
+    return encoded.get();
+}
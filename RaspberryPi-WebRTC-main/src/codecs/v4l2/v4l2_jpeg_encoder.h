@@ -0,0 +1,29 @@
+#ifndef V4L2_JPEG_ENCODER_H_
+#define V4L2_JPEG_ENCODER_H_
+
+#include <api/video/video_frame_buffer.h>
+
+#include "codecs/v4l2/v4l2_codec.h"
+#include "common/utils.h"
+
+class V4L2JpegEncoder : public V4L2Codec {
+  public:
+    // Returns nullptr when the board has no m2m jpeg encoder.
+    static std::unique_ptr<V4L2JpegEncoder> Create(int width, int height, int quality);
+    V4L2JpegEncoder();
+
+    // Blocks the calling thread until the encoded image is back, an empty buffer on failure.
+    Buffer Encode(const webrtc::I420BufferInterface &i420_buffer, int quality);
+    void SetQuality(int quality);
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+  private:
+    int width_;
+    int height_;
+    int quality_;
+
+    bool Configure(int width, int height, int quality);
+};
+
+#endif // V4L2_JPEG_ENCODER_H_
@@ -0,0 +1,232 @@
+#include "codecs/v4l2/v4l2_shared_h264_encoder.h"
+#include "common/logging.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+std::shared_ptr<V4L2EncoderHub> V4L2EncoderHub::Get(int width, int height, bool is_dma_src,
+                                                    const Args &args) {
+    static std::mutex hubs_mutex;
+    static std::map<std::tuple<int, int, bool>, std::weak_ptr<V4L2EncoderHub>> hubs;
+
+    std::lock_guard<std::mutex> lock(hubs_mutex);
+    auto key = std::make_tuple(width, height, is_dma_src);
+    auto hub = hubs[key].lock();
+    if (!hub) {
+        hub = std::make_shared<V4L2EncoderHub>(width, height, is_dma_src, args);
+        hubs[key] = hub;
+    }
+    return hub;
+}
+
+V4L2EncoderHub::V4L2EncoderHub(int width, int height, bool is_dma_src, const Args &args)
+    : delivering_(false),
+      last_timestamp_us_(-1),
+      pending_key_frame_(false),
+      encoder_(V4L2EncoderPool::Shared()->Acquire(width, height, is_dma_src,
+                                                  args.v4l2_h264_profile)) {
+    if (encoder_) {
+        encoder_->SetControls(args);
+    }
+}
+
+V4L2EncoderHub::~V4L2EncoderHub() { encoder_.reset(); }
+
+bool V4L2EncoderHub::IsOpen() const { return encoder_ != nullptr; }
+
+void V4L2EncoderHub::Subscribe(V4L2SharedH264Encoder *encoder) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscribers_.push_back({encoder, 0, 0});
+    // a joining peer can only start decoding from an idr.
+    pending_key_frame_ = true;
+}
+
+void V4L2EncoderHub::UnSubscribe(V4L2SharedH264Encoder *encoder) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    subscribers_.erase(std::remove_if(subscribers_.begin(), subscribers_.end(),
+                                      [encoder](const Subscriber &subscriber) {
+                                          return subscriber.encoder == encoder;
+                                      }),
+                       subscribers_.end());
+    ApplyRates();
+
+    // the encoder may still be in a delivery that copied the list before, unless it is ours.
+    auto self = std::this_thread::get_id();
+    delivered_.wait(lock, [this, self]() {
+        return !delivering_ || delivering_thread_ == self;
+    });
+}
+
+void V4L2EncoderHub::Encode(const webrtc::VideoFrame &frame, bool key_frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_key_frame_ |= key_frame;
+    if (frame.timestamp_us() <= last_timestamp_us_) {
+        // another peer already queued this frame.
+        return;
+    }
+    last_timestamp_us_ = frame.timestamp_us();
+
+    if (pending_key_frame_) {
+        V4L2Util::SetExtCtrl(encoder_->GetFd(), V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME, 1);
+        pending_key_frame_ = false;
+    }
+
+    V4L2Buffer src_buffer = V4L2H264Encoder::GetSourceBuffer(frame);
+    encoder_->EmplaceBuffer(src_buffer, [this, frame](V4L2Buffer encoded_buffer) {
+        OnEncoded(frame, encoded_buffer);
+    });
+}
+
+void V4L2EncoderHub::SetRates(V4L2SharedH264Encoder *encoder, uint32_t bitrate_bps, int fps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &subscriber : subscribers_) {
+        if (subscriber.encoder == encoder) {
+            subscriber.bitrate_bps = bitrate_bps;
+            subscriber.fps = fps;
+        }
+    }
+    ApplyRates();
+}
+
+/* The hardware runs one rate for everyone, so it takes the lowest bitrate any peer asked for. A
+ * peer on a poor link then lowers the quality for all, but none of them is sent more than its
+ * congestion control allows. Peers that have not reported a rate yet are left out. */
+void V4L2EncoderHub::ApplyRates() {
+    uint32_t bitrate_bps = 0;
+    int fps = 0;
+    for (auto &subscriber : subscribers_) {
+        if (subscriber.bitrate_bps > 0 &&
+            (bitrate_bps == 0 || subscriber.bitrate_bps < bitrate_bps)) {
+            bitrate_bps = subscriber.bitrate_bps;
+        }
+        fps = std::max(fps, subscriber.fps);
+    }
+
+    if (bitrate_bps > 0) {
+        encoder_->SetBitrate(bitrate_bps);
+    }
+    if (fps > 0) {
+        encoder_->SetFps(fps);
+    }
+}
+
+void V4L2EncoderHub::OnEncoded(const webrtc::VideoFrame &frame, V4L2Buffer &encoded_buffer) {
+    auto encoded_image_buffer =
+        webrtc::EncodedImageBuffer::Create((uint8_t *)encoded_buffer.start, encoded_buffer.length);
+    bool is_key_frame = encoded_buffer.flags & V4L2_BUF_FLAG_KEYFRAME;
+
+    // sinks run without the lock, so one may call back into the hub and a slow one only holds up
+    // this delivery.
+    std::vector<Subscriber> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers = subscribers_;
+        delivering_ = true;
+        delivering_thread_ = std::this_thread::get_id();
+    }
+    for (auto &subscriber : subscribers) {
+        subscriber.encoder->SendEncodedImage(frame, encoded_image_buffer, is_key_frame);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        delivering_ = false;
+    }
+    delivered_.notify_all();
+}
+
+std::unique_ptr<webrtc::VideoEncoder> V4L2SharedH264Encoder::Create(Args args) {
+    return std::make_unique<V4L2SharedH264Encoder>(args);
+}
+
+V4L2SharedH264Encoder::V4L2SharedH264Encoder(Args args)
+    : V4L2H264Encoder(args) {}
+
+V4L2SharedH264Encoder::~V4L2SharedH264Encoder() { Release(); }
+
+int32_t V4L2SharedH264Encoder::InitEncode(const webrtc::VideoCodec *codec_settings,
+                                          const VideoEncoder::Settings &settings) {
+    codec_ = *codec_settings;
+    width_ = codec_settings->width;
+    height_ = codec_settings->height;
+    bitrate_adjuster_.SetTargetBitrateBps(codec_settings->startBitrate * 1000);
+
+    encoded_image_.timing_.flags = webrtc::VideoSendTiming::TimingFrameFlags::kInvalid;
+    encoded_image_.content_type_ = webrtc::VideoContentType::UNSPECIFIED;
+
+    if (codec_.codecType != webrtc::kVideoCodecH264) {
+        return WEBRTC_VIDEO_CODEC_ERROR;
+    }
+
+    if (!JoinHub()) {
+        return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+    }
+    return WEBRTC_VIDEO_CODEC_OK;
+}
+
+bool V4L2SharedH264Encoder::JoinHub() {
+    Release();
+    hub_ = V4L2EncoderHub::Get(width_, height_, is_dma_, args_);
+    if (!hub_->IsOpen()) {
+        hub_.reset();
+        return false;
+    }
+    hub_->Subscribe(this);
+    return true;
+}
+
+int32_t V4L2SharedH264Encoder::Release() {
+    if (hub_) {
+        hub_->UnSubscribe(this);
+        hub_.reset();
+    }
+    return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t V4L2SharedH264Encoder::Encode(const webrtc::VideoFrame &frame,
+                                      const std::vector<webrtc::VideoFrameType> *frame_types) {
+    if (!hub_) {
+        return WEBRTC_VIDEO_CODEC_UNINITIALIZED;
+    }
+
+    bool key_frame = false;
+    if (frame_types) {
+        if ((*frame_types)[0] == webrtc::VideoFrameType::kVideoFrameKey) {
+            key_frame = true;
+        } else if ((*frame_types)[0] == webrtc::VideoFrameType::kEmptyFrame) {
+            return WEBRTC_VIDEO_CODEC_OK;
+        }
+    }
+
+    if (is_dma_ && GetSourceBuffer(frame).dmafd <= 0) {
+        // the frames turned out to be in cpu memory, e.g. libcamera rows repacked for padding,
+        // so this peer moves to the hub that copies them.
+        is_dma_ = false;
+        if (!JoinHub()) {
+            return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+        }
+        hub_->SetRates(this, bitrate_adjuster_.GetAdjustedBitrateBps(), fps_adjuster_);
+    }
+
+    hub_->Encode(frame, key_frame);
+    return WEBRTC_VIDEO_CODEC_OK;
+}
+
+void V4L2SharedH264Encoder::SetRates(const RateControlParameters &parameters) {
+    if (parameters.bitrate.get_sum_bps() <= 0 || parameters.framerate_fps <= 0) {
+        return;
+    }
+    bitrate_adjuster_.SetTargetBitrateBps(parameters.bitrate.get_sum_bps());
+    fps_adjuster_ = parameters.framerate_fps;
+
+    if (!hub_) {
+        return;
+    }
+    hub_->SetRates(this, bitrate_adjuster_.GetAdjustedBitrateBps(), fps_adjuster_);
+}
+
+webrtc::VideoEncoder::EncoderInfo V4L2SharedH264Encoder::GetEncoderInfo() const {
+    EncoderInfo info = V4L2H264Encoder::GetEncoderInfo();
+    info.implementation_name += "(Shared)";
+    return info;
+}
@@ -0,0 +1,73 @@
+#ifndef V4L2_SHARED_H264_ENCODER_H_
+#define V4L2_SHARED_H264_ENCODER_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "codecs/v4l2/v4l2_h264_encoder.h"
+
+class V4L2SharedH264Encoder;
+
+/* Encodes each frame once for every peer sending the same resolution. Peers feed it the same
+ * frames, only the first copy of a frame is queued to the hardware, and the encoded image goes
+ * back to all peers by reference. A key frame request from any peer is served to all of them, and
+ * the bitrate is the lowest one any peer asked for, see ApplyRates(). */
+class V4L2EncoderHub {
+  public:
+    static std::shared_ptr<V4L2EncoderHub> Get(int width, int height, bool is_dma_src,
+                                               const Args &args);
+    V4L2EncoderHub(int width, int height, bool is_dma_src, const Args &args);
+    ~V4L2EncoderHub();
+
+    bool IsOpen() const;
+    void Subscribe(V4L2SharedH264Encoder *encoder);
+    void UnSubscribe(V4L2SharedH264Encoder *encoder);
+    void Encode(const webrtc::VideoFrame &frame, bool key_frame);
+    void SetRates(V4L2SharedH264Encoder *encoder, uint32_t bitrate_bps, int fps);
+
+  private:
+    struct Subscriber {
+        V4L2SharedH264Encoder *encoder;
+        uint32_t bitrate_bps;
+        int fps;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable delivered_;
+    std::vector<Subscriber> subscribers_;
+    // set while OnEncoded() hands an image to a copy of the subscribers.
+    bool delivering_;
+    std::thread::id delivering_thread_;
+    int64_t last_timestamp_us_;
+    bool pending_key_frame_;
+    V4L2EncoderPool::Session encoder_;
+
+    void ApplyRates();
+    void OnEncoded(const webrtc::VideoFrame &frame, V4L2Buffer &encoded_buffer);
+};
+
+class V4L2SharedH264Encoder : public V4L2H264Encoder {
+  public:
+    static std::unique_ptr<webrtc::VideoEncoder> Create(Args args);
+    V4L2SharedH264Encoder(Args args);
+    ~V4L2SharedH264Encoder() override;
+
+    int32_t InitEncode(const webrtc::VideoCodec *codec_settings,
+                       const VideoEncoder::Settings &settings) override;
+    int32_t Release() override;
+    int32_t Encode(const webrtc::VideoFrame &frame,
+                   const std::vector<webrtc::VideoFrameType> *frame_types) override;
+    void SetRates(const RateControlParameters &parameters) override;
+    webrtc::VideoEncoder::EncoderInfo GetEncoderInfo() const override;
+
+  private:
+    friend class V4L2EncoderHub;
+    std::shared_ptr<V4L2EncoderHub> hub_;
+
+    // Subscribes to the hub for the current size and source memory, false if it has no encoder.
+    bool JoinHub();
+};
+
+#endif // V4L2_SHARED_H264_ENCODER_H_
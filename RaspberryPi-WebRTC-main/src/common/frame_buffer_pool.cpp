@@ -0,0 +1,100 @@
+#include "common/frame_buffer_pool.h"
+
+#include <rtc_base/memory/aligned_malloc.h>
+
+// Aligning pointer to 64 bytes for improved performance, e.g. use SIMD.
+static const int kBufferAlignment = 64;
+// Buckets from 4 KiB to 64 MiB, larger requests bypass the pool.
+static const int kMinBucketShift = 12;
+static const int kMaxBucketShift = 26;
+// Frame sizes with a pool of their own, any further size is allocated on demand.
+static const size_t kMaxI420Sizes = 16;
+
+static int BucketOf(size_t size) {
+    int shift = kMinBucketShift;
+    while (((size_t)1 << shift) < size) {
+        shift++;
+    }
+    return shift <= kMaxBucketShift ? shift - kMinBucketShift : -1;
+}
+
+std::shared_ptr<FrameDataPool> FrameDataPool::Shared() {
+    static std::shared_ptr<FrameDataPool> pool = std::make_shared<FrameDataPool>(8);
+    return pool;
+}
+
+FrameDataPool::FrameDataPool(int max_free_per_bucket) {
+    for (int shift = kMinBucketShift; shift <= kMaxBucketShift; shift++) {
+        free_blocks_.push_back(std::make_unique<MpmcQueue<uint8_t *>>(max_free_per_bucket));
+    }
+}
+
+FrameDataPool::~FrameDataPool() {
+    for (auto &blocks : free_blocks_) {
+        while (auto data = blocks->pop()) {
+            webrtc::AlignedFree(*data);
+        }
+    }
+}
+
+FrameDataPool::Block FrameDataPool::Acquire(size_t size) {
+    int bucket = BucketOf(size);
+    if (bucket < 0) {
+        return Block(static_cast<uint8_t *>(webrtc::AlignedMalloc(size, kBufferAlignment)),
+                     Deleter());
+    }
+
+    auto data = free_blocks_[bucket]->pop();
+    uint8_t *block = data ? *data
+                          : static_cast<uint8_t *>(webrtc::AlignedMalloc(
+                                (size_t)1 << (bucket + kMinBucketShift), kBufferAlignment));
+    return Block(block, Deleter{shared_from_this(), bucket});
+}
+
+void FrameDataPool::Release(uint8_t *data, int bucket) {
+    if (!free_blocks_[bucket]->push(data)) {
+        webrtc::AlignedFree(data);
+    }
+}
+
+void FrameDataPool::Deleter::operator()(uint8_t *data) const {
+    if (pool && bucket >= 0) {
+        pool->Release(data, bucket);
+    } else {
+        webrtc::AlignedFree(data);
+    }
+}
+
+I420BufferPool &I420BufferPool::Shared() {
+    static I420BufferPool pool(8);
+    return pool;
+}
+
+I420BufferPool::I420BufferPool(size_t max_buffers)
+    : max_buffers_(max_buffers) {}
+
+I420BufferPool::SizedPool *I420BufferPool::PoolOf(int width, int height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto key = std::make_pair(width, height);
+    auto it = pools_.find(key);
+    if (it != pools_.end()) {
+        return it->second.get();
+    }
+    if (pools_.size() >= kMaxI420Sizes) {
+        return nullptr;
+    }
+    return pools_.emplace(key, std::make_unique<SizedPool>(max_buffers_)).first->second.get();
+}
+
+rtc::scoped_refptr<webrtc::I420Buffer> I420BufferPool::Create(int width, int height) {
+    rtc::scoped_refptr<webrtc::I420Buffer> buffer;
+    if (auto *sized_pool = PoolOf(width, height)) {
+        std::lock_guard<std::mutex> lock(sized_pool->mutex);
+        buffer = sized_pool->pool.CreateI420Buffer(width, height);
+    }
+    // every pooled buffer of this size is still in use, or too many sizes came up.
+    if (!buffer) {
+        buffer = webrtc::I420Buffer::Create(width, height);
+    }
+    return buffer;
+}
@@ -0,0 +1,68 @@
+#ifndef FRAME_BUFFER_POOL_H_
+#define FRAME_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <api/video/i420_buffer.h>
+#include <common_video/include/video_frame_buffer_pool.h>
+
+#include "common/lock_free_queue.h"
+
+/* Recycles the aligned blocks frames are copied into. Blocks are kept in power-of-two size
+ * buckets, so MJPEG frames of varying size still find a free block. A block goes back to its
+ * bucket when released, or is freed if the bucket already holds enough spare blocks. */
+class FrameDataPool : public std::enable_shared_from_this<FrameDataPool> {
+  public:
+    struct Deleter {
+        std::shared_ptr<FrameDataPool> pool;
+        int bucket = -1;
+        void operator()(uint8_t *data) const;
+    };
+    using Block = std::unique_ptr<uint8_t, Deleter>;
+
+    static std::shared_ptr<FrameDataPool> Shared();
+
+    FrameDataPool(int max_free_per_bucket);
+    ~FrameDataPool();
+
+    Block Acquire(size_t size);
+
+  private:
+    std::vector<std::unique_ptr<MpmcQueue<uint8_t *>>> free_blocks_;
+
+    void Release(uint8_t *data, int bucket);
+};
+
+/* webrtc::VideoFrameBufferPool is single threaded and drops all its buffers whenever the size
+ * changes, this one serves conversions on any thread and keeps a pool of up to `max_buffers` per
+ * frame size, so scaled copies, simulcast layers and several cameras don't evict each other. */
+class I420BufferPool {
+  public:
+    static I420BufferPool &Shared();
+
+    I420BufferPool(size_t max_buffers);
+    // The content is not initialized, callers overwrite every plane.
+    rtc::scoped_refptr<webrtc::I420Buffer> Create(int width, int height);
+
+  private:
+    struct SizedPool {
+        SizedPool(size_t max_buffers)
+            : pool(false, max_buffers) {}
+        std::mutex mutex;
+        webrtc::VideoFrameBufferPool pool;
+    };
+
+    size_t max_buffers_;
+    std::mutex mutex_;
+    std::map<std::pair<int, int>, std::unique_ptr<SizedPool>> pools_;
+
+    SizedPool *PoolOf(int width, int height);
+};
+
+#endif // FRAME_BUFFER_POOL_H_
@@ -2,54 +2,196 @@
 #define SUBJECT_H_
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+#include "common/lock_free_queue.h"
+
 template <typename T> class Observable {
   public:
-    Observable() = default;
-    ~Observable() = default;
     using OnMessageFunc = std::function<void(T)>;
 
-    void Subscribe(OnMessageFunc func) { subscribed_func_ = func; }
-    void UnSubscribe() { subscribed_func_ = nullptr; }
+    enum class Policy { kDropOldest, kBlock };
+
+    /* With queue_size > 0 the observer runs on its own consumer thread, fed through a bounded
+     * queue, so a slow observer never holds up the publisher or other observers. `retain` runs on
+     * the publisher's thread before a message is queued, for data only valid during Next(). */
+    struct Options {
+        size_t queue_size = 0;
+        Policy policy = Policy::kDropOldest;
+        std::function<void(T &)> retain;
+    };
+
+    Observable() = default;
+    ~Observable() { UnSubscribe(); }
+
+    void Subscribe(OnMessageFunc func) { Subscribe(func, Options()); }
+
+    void Subscribe(OnMessageFunc func, Options options) {
+        UnSubscribe();
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribed_func_ = func;
+        options_ = options;
+        if (options_.queue_size > 0) {
+            queue_ = std::make_shared<BlockingQueue<T>>(options_.queue_size);
+            consumer_ = std::thread([func, queue = queue_]() {
+                while (auto message = queue->wait_pop()) {
+                    func(std::move(*message));
+                }
+            });
+        }
+    }
+
+    /* Returns once no callback runs anymore, so the owner can free what the callback uses. An
+     * inline observer may unsubscribe itself, an async one must not be unsubscribed or released
+     * from its own callback. */
+    void UnSubscribe() {
+        std::thread consumer;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            subscribed_func_ = nullptr;
+            auto self = std::this_thread::get_id();
+            call_finished_.wait(lock, [this, self]() {
+                return std::all_of(callers_.begin(), callers_.end(), [self](std::thread::id id) {
+                    return id == self;
+                });
+            });
+            if (queue_) {
+                queue_->Close();
+                queue_.reset();
+            }
+            consumer.swap(consumer_);
+        }
+        if (consumer.joinable()) {
+            consumer.join();
+        }
+    }
+
+    void Next(T message) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!subscribed_func_) {
+            return;
+        }
 
+        if (!queue_) {
+            auto func = subscribed_func_;
+            auto caller = std::this_thread::get_id();
+            callers_.push_back(caller);
+            lock.unlock();
+            try {
+                func(message);
+            } catch (...) {
+                EndCall(caller);
+                throw;
+            }
+            EndCall(caller);
+            return;
+        }
+
+        if (options_.retain) {
+            options_.retain(message);
+        }
+        auto queue = queue_;
+        auto policy = options_.policy;
+        lock.unlock();
+
+        if (policy == Policy::kBlock) {
+            queue->wait_push(std::move(message));
+            return;
+        }
+        while (!queue->push(std::move(message))) {
+            if (queue->pop()) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  private:
+    std::mutex mutex_;
+    std::condition_variable call_finished_;
+    // threads running the inline callback right now.
+    std::vector<std::thread::id> callers_;
     OnMessageFunc subscribed_func_;
+    Options options_;
+    std::shared_ptr<BlockingQueue<T>> queue_;
+    std::thread consumer_;
+    std::atomic<uint64_t> dropped_{0};
+
+    void EndCall(std::thread::id caller) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            callers_.erase(std::find(callers_.begin(), callers_.end(), caller));
+        }
+        call_finished_.notify_all();
+    }
 };
 
+/* Subjects only keep weak handles, an observer is unsubscribed once its owner releases it. */
 template <typename T> class Subject {
   public:
     virtual ~Subject() = default;
     virtual void Next(T message) {
-        for (auto &observer : observers_) {
-            if (observer && observer->subscribed_func_ != nullptr) {
-                observer->subscribed_func_(message);
-            }
+        for (auto &observer : LockObservers()) {
+            observer->Next(message);
         }
     }
 
     virtual std::shared_ptr<Observable<T>> AsObservable() {
         auto observer = std::make_shared<Observable<T>>();
+        std::lock_guard<std::mutex> lock(observers_mutex_);
         observers_.push_back(observer);
         return observer;
     }
 
+    // What each live observer dropped so far, so a slow consumer shows up on its own.
+    std::vector<uint64_t> dropped() {
+        std::vector<uint64_t> counts;
+        for (auto &observer : LockObservers()) {
+            counts.push_back(observer->dropped());
+        }
+        return counts;
+    }
+
     virtual void UnSubscribe() {
-        auto it = observers_.begin();
-        while (it != observers_.end()) {
-            it->reset();
-            it = observers_.erase(it);
+        std::vector<std::shared_ptr<Observable<T>>> observers = LockObservers();
+        {
+            std::lock_guard<std::mutex> lock(observers_mutex_);
+            observers_.clear();
+        }
+        for (auto &observer : observers) {
+            observer->UnSubscribe();
         }
     }
 
   protected:
-    std::vector<std::shared_ptr<Observable<T>>> observers_;
+    std::mutex observers_mutex_;
+    std::vector<std::weak_ptr<Observable<T>>> observers_;
+
+    std::vector<std::shared_ptr<Observable<T>>> LockObservers() {
+        std::vector<std::shared_ptr<Observable<T>>> observers;
+        std::lock_guard<std::mutex> lock(observers_mutex_);
+        observers.reserve(observers_.size());
+        for (auto &weak : observers_) {
+            if (auto observer = weak.lock()) {
+                observers.push_back(std::move(observer));
+            }
+        }
+        RemoveExpiredObservers();
+        return observers;
+    }
 
-    void RemoveNullObservers() {
+    void RemoveExpiredObservers() {
         auto new_end = std::remove_if(observers_.begin(), observers_.end(),
-                                      [](const std::shared_ptr<Observable<T>> observer) {
-                                          return !observer;
+                                      [](const std::weak_ptr<Observable<T>> &observer) {
+                                          return observer.expired();
                                       });
         observers_.erase(new_end, observers_.end());
     }
@@ -0,0 +1,251 @@
+#ifndef LOCK_FREE_QUEUE_
+#define LOCK_FREE_QUEUE_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+static constexpr size_t kCacheLineSize = 64;
+
+inline size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t size = 2;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+/* Bounded ring for exactly one producer and one consumer thread. Head and tail live on their own
+ * cache lines, each next to the owner's cached copy of the other index. */
+template <typename T> class SpscQueue {
+  public:
+    explicit SpscQueue(size_t capacity)
+        : mask_(RoundUpToPowerOfTwo(capacity) - 1),
+          slots_(new T[mask_ + 1]) {}
+
+    // Returns false when full, in which case `t` is left untouched.
+    template <typename U> bool push(U &&t) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = std::forward<U>(t);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> pop() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return std::nullopt;
+            }
+        }
+        std::optional<T> t(std::move(slots_[head & mask_]));
+        slots_[head & mask_] = T(); // release what the slot refers to right away
+        head_.store(head + 1, std::memory_order_release);
+        return t;
+    }
+
+    // Consumer side only, nullptr when empty.
+    T *front() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots_[head & mask_];
+    }
+
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+  private:
+    const size_t mask_;
+    const std::unique_ptr<T[]> slots_;
+
+    alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+    alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+};
+
+/* Bounded ring for any number of producers and consumers (D. Vyukov's design), each cell carries
+ * a sequence number telling whether it is ready to be written or read for the current lap. */
+template <typename T> class MpmcQueue {
+  public:
+    explicit MpmcQueue(size_t capacity)
+        : mask_(RoundUpToPowerOfTwo(capacity) - 1),
+          cells_(new Cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Returns false when full, in which case `t` is left untouched.
+    template <typename U> bool push(U &&t) {
+        Cell *cell;
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::forward<U>(t);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> pop() {
+        Cell *cell;
+        size_t pos = head_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+        std::optional<T> t(std::move(cell->data));
+        cell->data = T();
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return t;
+    }
+
+    // Approximate while other threads are pushing or popping.
+    size_t size() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+  private:
+    struct alignas(kCacheLineSize) Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    const size_t mask_;
+    const std::unique_ptr<Cell[]> cells_;
+
+    alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+    alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+};
+
+/* Futex backed event count: read Epoch(), re-check the condition, then Wait(epoch). A Notify()
+ * after the epoch was read wakes the waiter, so no wakeup is lost. Notify costs no syscall while
+ * nobody waits. */
+class QueueNotifier {
+  public:
+    uint32_t Epoch() const { return epoch_.load(); }
+    void Wait(uint32_t epoch) const { epoch_.wait(epoch); }
+    void NotifyOne() {
+        epoch_.fetch_add(1);
+        epoch_.notify_one();
+    }
+    void NotifyAll() {
+        epoch_.fetch_add(1);
+        epoch_.notify_all();
+    }
+
+  private:
+    std::atomic<uint32_t> epoch_{0};
+};
+
+/* Adds blocking waits on top of a lock-free ring, so consumers need not poll. */
+template <typename T, typename Queue = MpmcQueue<T>> class BlockingQueue {
+  public:
+    explicit BlockingQueue(size_t capacity)
+        : queue_(capacity) {}
+
+    template <typename U> bool push(U &&t) {
+        if (!queue_.push(std::forward<U>(t))) {
+            return false;
+        }
+        not_empty_.NotifyOne();
+        return true;
+    }
+
+    // Blocks while full, returns false once closed.
+    template <typename U> bool wait_push(U &&t) {
+        while (true) {
+            uint32_t epoch = not_full_.Epoch();
+            if (closed_.load()) {
+                return false;
+            }
+            if (push(std::forward<U>(t))) {
+                return true;
+            }
+            not_full_.Wait(epoch);
+        }
+    }
+
+    std::optional<T> pop() {
+        auto t = queue_.pop();
+        if (t) {
+            not_full_.NotifyOne();
+        }
+        return t;
+    }
+
+    // Blocks while empty, returns nullopt once closed.
+    std::optional<T> wait_pop() {
+        while (true) {
+            uint32_t epoch = not_empty_.Epoch();
+            if (closed_.load()) {
+                return std::nullopt;
+            }
+            if (auto t = pop()) {
+                return t;
+            }
+            not_empty_.Wait(epoch);
+        }
+    }
+
+    // Wakes every waiter, later waits return right away.
+    void Close() {
+        closed_.store(true);
+        not_empty_.NotifyAll();
+        not_full_.NotifyAll();
+    }
+
+    bool is_closed() const { return closed_.load(); }
+    size_t size() const { return queue_.size(); }
+    bool empty() const { return queue_.empty(); }
+    size_t capacity() const { return queue_.capacity(); }
+
+  private:
+    Queue queue_;
+    std::atomic<bool> closed_{false};
+    QueueNotifier not_empty_;
+    QueueNotifier not_full_;
+};
+
+#endif // LOCK_FREE_QUEUE_
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -11,7 +12,6 @@ extern "C" {
 #include <libavformat/avformat.h>
 }
 #include <jpeglib.h>
-#include <third_party/libyuv/include/libyuv.h>
 
 #include "common/logging.h"
 #include "common/utils.h"
@@ -360,12 +360,14 @@ std::string Utils::PrefixZero(int src, int digits) {
     return n_zero + str;
 }
 
-Buffer Utils::ConvertYuvToJpeg(const uint8_t *yuv_data, int width, int height, int quality) {
+/* Feeds the yuv planes to libjpeg's raw-data interface, so there is neither a rgb conversion nor a
+ * downsampling pass. Rows past the bottom edge repeat the last one, as libjpeg expects whole MCUs. */
+static Buffer CompressYuvPlanes(const uint8_t *y, int stride_y, const uint8_t *u, int stride_u,
+                                const uint8_t *v, int stride_v, int width, int height,
+                                int quality) {
     struct jpeg_compress_struct cinfo;
     struct jpeg_error_mgr jerr;
 
-    Buffer jpegBuffer;
-
     cinfo.err = jpeg_std_error(&jerr);
     jpeg_create_compress(&cinfo);
     uint8_t *data = nullptr;
@@ -375,35 +377,84 @@ Buffer Utils::ConvertYuvToJpeg(const uint8_t *yuv_data, int width, int height, i
     cinfo.image_width = width;
     cinfo.image_height = height;
     cinfo.input_components = 3;
-    cinfo.in_color_space = JCS_EXT_BGR;
+    cinfo.in_color_space = JCS_YCbCr;
 
     jpeg_set_defaults(&cinfo);
+    jpeg_set_colorspace(&cinfo, JCS_YCbCr);
     jpeg_set_quality(&cinfo, quality, TRUE);
+    cinfo.raw_data_in = TRUE;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.comp_info[0].h_samp_factor = 2;
+    cinfo.comp_info[0].v_samp_factor = 2;
+    cinfo.comp_info[1].h_samp_factor = 1;
+    cinfo.comp_info[1].v_samp_factor = 1;
+    cinfo.comp_info[2].h_samp_factor = 1;
+    cinfo.comp_info[2].v_samp_factor = 1;
+
+    // libjpeg reads whole MCUs per row, narrower rows are padded into scratch lines.
+    const int kMcuSize = 2 * DCTSIZE;
+    int chroma_width = (width + 1) / 2;
+    int chroma_height = (height + 1) / 2;
+    int padded_width = (width + kMcuSize - 1) / kMcuSize * kMcuSize;
+    bool needs_padding = padded_width != width;
+    std::vector<uint8_t> scratch;
+    if (needs_padding) {
+        scratch.resize(padded_width * kMcuSize + padded_width / 2 * DCTSIZE * 2);
+    }
 
-    JSAMPROW row_pointer[1];
-    int row_stride = width * 3;
-    uint8_t *rgb_data = (uint8_t *)malloc(width * height * 3);
-    libyuv::I420ToRGB24(yuv_data, width, yuv_data + width * height, width / 2,
-                        yuv_data + width * height + (width * height / 4), width / 2, rgb_data,
-                        width * 3, width, height);
+    JSAMPROW y_rows[kMcuSize];
+    JSAMPROW u_rows[DCTSIZE];
+    JSAMPROW v_rows[DCTSIZE];
+    JSAMPARRAY planes[3] = {y_rows, u_rows, v_rows};
+
+    auto pad_row = [](const uint8_t *src, int src_width, uint8_t *dst, int dst_width) {
+        memcpy(dst, src, src_width);
+        memset(dst + src_width, src[src_width - 1], dst_width - src_width);
+        return dst;
+    };
 
     jpeg_start_compress(&cinfo, TRUE);
 
-    while (cinfo.next_scanline < cinfo.image_height) {
-        row_pointer[0] = &rgb_data[cinfo.next_scanline * row_stride];
-        jpeg_write_scanlines(&cinfo, row_pointer, 1);
+    for (int row = 0; row < height; row += kMcuSize) {
+        for (int i = 0; i < kMcuSize; i++) {
+            const uint8_t *src = y + std::min(row + i, height - 1) * stride_y;
+            y_rows[i] = needs_padding
+                            ? pad_row(src, width, &scratch[i * padded_width], padded_width)
+                            : const_cast<uint8_t *>(src);
+        }
+        for (int i = 0; i < DCTSIZE; i++) {
+            int chroma_row = std::min(row / 2 + i, chroma_height - 1);
+            const uint8_t *src_u = u + chroma_row * stride_u;
+            const uint8_t *src_v = v + chroma_row * stride_v;
+            if (needs_padding) {
+                uint8_t *dst_u = &scratch[padded_width * kMcuSize + i * padded_width / 2];
+                uint8_t *dst_v = dst_u + padded_width / 2 * DCTSIZE;
+                u_rows[i] = pad_row(src_u, chroma_width, dst_u, padded_width / 2);
+                v_rows[i] = pad_row(src_v, chroma_width, dst_v, padded_width / 2);
+            } else {
+                u_rows[i] = const_cast<uint8_t *>(src_u);
+                v_rows[i] = const_cast<uint8_t *>(src_v);
+            }
+        }
+        jpeg_write_raw_data(&cinfo, planes, kMcuSize);
     }
 
     jpeg_finish_compress(&cinfo);
     jpeg_destroy_compress(&cinfo);
-    free(rgb_data);
 
+    Buffer jpegBuffer;
     jpegBuffer.start = std::unique_ptr<uint8_t, FreeDeleter>(data);
     jpegBuffer.length = size;
 
     return jpegBuffer;
 }
 
+Buffer Utils::ConvertYuvToJpeg(const webrtc::I420BufferInterface &i420_buffer, int quality) {
+    return CompressYuvPlanes(i420_buffer.DataY(), i420_buffer.StrideY(), i420_buffer.DataU(),
+                             i420_buffer.StrideU(), i420_buffer.DataV(), i420_buffer.StrideV(),
+                             i420_buffer.width(), i420_buffer.height(), quality);
+}
+
 void Utils::WriteJpegImage(Buffer buffer, const std::string &url) {
     FILE *file = fopen(url.c_str(), "wb");
     if (file) {
@@ -415,10 +466,10 @@ void Utils::WriteJpegImage(Buffer buffer, const std::string &url) {
     }
 }
 
-void Utils::CreateJpegImage(const uint8_t *yuv_data, int width, int height, const std::string &url,
+void Utils::CreateJpegImage(const webrtc::I420BufferInterface &i420_buffer, const std::string &url,
                             int quality) {
     try {
-        auto jpg_buffer = Utils::ConvertYuvToJpeg(yuv_data, width, height, quality);
+        auto jpg_buffer = Utils::ConvertYuvToJpeg(i420_buffer, quality);
         WriteJpegImage(std::move(jpg_buffer), url);
     } catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << std::endl;
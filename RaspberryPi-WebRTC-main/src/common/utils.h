@@ -4,6 +4,8 @@
 #include <filesystem>
 #include <vector>
 
+#include <api/video/video_frame_buffer.h>
+
 namespace fs = std::filesystem;
 
 struct FreeDeleter {
@@ -37,9 +39,9 @@ class Utils {
     static bool CreateFolder(const std::string &folder_path);
     static void RotateFiles(const std::string &folder_path);
     static bool CheckDriveSpace(const std::string &file_path, unsigned long min_free_byte);
-    static Buffer ConvertYuvToJpeg(const uint8_t *yuv_data, int width, int height,
+    static Buffer ConvertYuvToJpeg(const webrtc::I420BufferInterface &i420_buffer,
                                    int quality = 100);
-    static void CreateJpegImage(const uint8_t *yuv_data, int width, int height,
+    static void CreateJpegImage(const webrtc::I420BufferInterface &i420_buffer,
                                 const std::string &url, int quality);
     static void WriteJpegImage(Buffer buffer, const std::string &url);
     static int GetVideoDuration(const std::string &filePath);
@@ -0,0 +1,159 @@
+#include "common/v4l2_buffer_pool.h"
+#include "common/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+
+static const int kBufferAlignment = 64;
+
+V4L2BufferLease::V4L2BufferLease(std::shared_ptr<V4L2BufferPool> pool, int index,
+                                 V4L2Buffer buffer)
+    : pool_(std::move(pool)),
+      index_(index),
+      buffer_(buffer) {}
+
+V4L2BufferLease::V4L2BufferLease(V4L2Buffer buffer, std::function<void()> release)
+    : release_(std::move(release)),
+      index_(-1),
+      buffer_(buffer) {}
+
+V4L2BufferLease::~V4L2BufferLease() {
+    if (pool_) {
+        pool_->Requeue(index_);
+    } else if (release_) {
+        release_();
+    }
+}
+
+const V4L2Buffer &V4L2BufferLease::buffer() const { return buffer_; }
+
+int V4L2BufferLease::index() const { return index_; }
+
+bool V4L2BufferLease::is_detached() const { return pool_ == nullptr && !release_; }
+
+void V4L2BufferLease::Detach() {
+    if (is_detached()) {
+        return;
+    }
+    copy_.reset(static_cast<uint8_t *>(webrtc::AlignedMalloc(buffer_.length, kBufferAlignment)));
+    memcpy(copy_.get(), buffer_.start, buffer_.length);
+    buffer_.start = copy_.get();
+    if (pool_) {
+        pool_->Requeue(index_);
+        pool_.reset();
+    } else {
+        release_();
+        release_ = nullptr;
+    }
+}
+
+std::shared_ptr<V4L2BufferPool> V4L2BufferPool::Create(int fd, V4L2BufferGroup gbuffer,
+                                                       int num_buffers, int max_buffers) {
+    auto pool = std::make_shared<V4L2BufferPool>(fd, gbuffer, std::max(num_buffers, max_buffers));
+    if (!pool->Start(num_buffers)) {
+        return nullptr;
+    }
+    return pool;
+}
+
+V4L2BufferPool::V4L2BufferPool(int fd, V4L2BufferGroup gbuffer, int max_buffers)
+    : fd_(dup(fd)),
+      max_buffers_(max_buffers),
+      min_queued_(2),
+      gbuffer_(gbuffer),
+      queued_(0),
+      size_(0) {
+    // The pool may outlive the capturer that opened the device.
+    gbuffer_.fd = fd_;
+}
+
+V4L2BufferPool::~V4L2BufferPool() {
+    V4L2Util::StreamOff(fd_, gbuffer_.type);
+    V4L2Util::DeallocateBuffer(fd_, &gbuffer_);
+    V4L2Util::CloseDevice(fd_);
+}
+
+bool V4L2BufferPool::Start(int num_buffers) {
+    if (!V4L2Util::AllocateBuffer(fd_, &gbuffer_, num_buffers) ||
+        !V4L2Util::QueueBuffers(fd_, &gbuffer_)) {
+        return false;
+    }
+    queued_.store(gbuffer_.num_buffers);
+    size_.store(gbuffer_.num_buffers);
+
+    return V4L2Util::StreamOn(fd_, gbuffer_.type);
+}
+
+int V4L2BufferPool::queued() const { return queued_.load(); }
+
+int V4L2BufferPool::size() const { return size_.load(); }
+
+rtc::scoped_refptr<V4L2BufferLease> V4L2BufferPool::Dequeue() {
+    v4l2_buffer buf = {};
+    v4l2_plane planes[VIDEO_MAX_PLANES] = {};
+    buf.type = gbuffer_.type;
+    buf.memory = gbuffer_.memory;
+    if (V4L2_TYPE_IS_MULTIPLANAR(buf.type)) {
+        buf.m.planes = planes;
+        buf.length = 1;
+    }
+
+    if (!V4L2Util::DequeueBuffer(fd_, &buf)) {
+        return nullptr;
+    }
+    int queued = queued_.fetch_sub(1) - 1;
+
+    const V4L2Buffer &mapped = gbuffer_.buffers[buf.index];
+    unsigned int bytesused =
+        V4L2_TYPE_IS_MULTIPLANAR(buf.type) ? planes[0].bytesused : buf.bytesused;
+    V4L2Buffer buffer(mapped.start, bytesused, buf.flags, buf.timestamp);
+    buffer.dmafd = mapped.dmafd;
+
+    auto lease = rtc::make_ref_counted<V4L2BufferLease>(shared_from_this(), buf.index, buffer);
+
+    // Consumers hold too many frames, keep the driver fed.
+    if (queued < min_queued_ && !Grow()) {
+        lease->Detach();
+    }
+
+    return lease;
+}
+
+bool V4L2BufferPool::Grow() {
+    int size = size_.load();
+    if (size >= max_buffers_) {
+        return false;
+    }
+
+    if (!V4L2Util::CreateBuffers(fd_, &gbuffer_, std::min(2, max_buffers_ - size))) {
+        max_buffers_ = size; // the driver can't add buffers while streaming
+        return false;
+    }
+
+    for (int i = size; i < gbuffer_.num_buffers; i++) {
+        if (V4L2Util::QueueBuffer(fd_, &gbuffer_.buffers[i].inner)) {
+            queued_.fetch_add(1);
+        }
+    }
+    size_.store(gbuffer_.num_buffers);
+    DEBUG_PRINT("fd(%d) buffer pool grew to %d buffers", fd_, gbuffer_.num_buffers);
+
+    return true;
+}
+
+void V4L2BufferPool::Requeue(int index) {
+    v4l2_buffer buf = {};
+    v4l2_plane planes[VIDEO_MAX_PLANES] = {};
+    buf.type = gbuffer_.type;
+    buf.memory = gbuffer_.memory;
+    buf.index = index;
+    if (V4L2_TYPE_IS_MULTIPLANAR(buf.type)) {
+        buf.m.planes = planes;
+        buf.length = 1;
+    }
+
+    if (V4L2Util::QueueBuffer(fd_, &buf)) {
+        queued_.fetch_add(1);
+    }
+}
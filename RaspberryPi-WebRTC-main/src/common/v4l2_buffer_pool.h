@@ -0,0 +1,70 @@
+#ifndef V4L2_BUFFER_POOL_H_
+#define V4L2_BUFFER_POOL_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include <rtc_base/memory/aligned_malloc.h>
+#include <rtc_base/ref_count.h>
+#include <rtc_base/ref_counted_object.h>
+
+#include "common/v4l2_utils.h"
+
+class V4L2BufferPool;
+
+/* A dequeued capture buffer. It goes back to the driver when the last reference is released,
+ * so consumers can keep the frame without copying it. */
+class V4L2BufferLease : public rtc::RefCountInterface {
+  public:
+    V4L2BufferLease(std::shared_ptr<V4L2BufferPool> pool, int index, V4L2Buffer buffer);
+    // For buffers owned elsewhere, e.g. a libcamera request, release gives the buffer back.
+    V4L2BufferLease(V4L2Buffer buffer, std::function<void()> release);
+    ~V4L2BufferLease() override;
+
+    const V4L2Buffer &buffer() const;
+    int index() const;
+    bool is_detached() const;
+
+    // Copy the payload out and return the driver buffer right away.
+    void Detach();
+
+  private:
+    std::shared_ptr<V4L2BufferPool> pool_;
+    std::function<void()> release_;
+    int index_;
+    V4L2Buffer buffer_;
+    std::unique_ptr<uint8_t, webrtc::AlignedFreeDeleter> copy_;
+};
+
+/* Owns the capture buffers of a V4L2 device while it streams. The pool grows with
+ * VIDIOC_CREATE_BUFS when consumers hold so many leases that the driver is about to run dry;
+ * once it cannot grow, new frames are detached (copied) instead of starving the driver. */
+class V4L2BufferPool : public std::enable_shared_from_this<V4L2BufferPool> {
+  public:
+    static std::shared_ptr<V4L2BufferPool> Create(int fd, V4L2BufferGroup gbuffer,
+                                                  int num_buffers, int max_buffers);
+
+    V4L2BufferPool(int fd, V4L2BufferGroup gbuffer, int max_buffers);
+    ~V4L2BufferPool();
+
+    rtc::scoped_refptr<V4L2BufferLease> Dequeue();
+    int queued() const;
+    int size() const;
+
+  private:
+    int fd_;
+    int max_buffers_;
+    int min_queued_;
+    V4L2BufferGroup gbuffer_;
+    std::atomic<int> queued_;
+    std::atomic<int> size_;
+
+    bool Start(int num_buffers);
+    bool Grow();
+    void Requeue(int index);
+
+    friend class V4L2BufferLease;
+};
+
+#endif // V4L2_BUFFER_POOL_H_
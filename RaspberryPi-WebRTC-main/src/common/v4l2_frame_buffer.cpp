@@ -1,10 +1,57 @@
 #include "common/v4l2_frame_buffer.h"
 #include "common/logging.h"
 
+#include <csetjmp>
+#include <jpeglib.h>
 #include <third_party/libyuv/include/libyuv.h>
 
-// Aligning pointer to 64 bytes for improved performance, e.g. use SIMD.
-static const int kBufferAlignment = 64;
+struct JpegErrorManager {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+};
+
+// libjpeg exits the process on errors by default, a corrupt frame only fails its own decode.
+static void OnJpegError(j_common_ptr cinfo) {
+    longjmp(reinterpret_cast<JpegErrorManager *>(cinfo->err)->jump, 1);
+}
+
+static void OnJpegMessage(j_common_ptr cinfo) {}
+
+/* Decodes a mjpeg frame at 1/scale_denom of its size into ARGB. The reduction happens in the
+ * inverse DCT, so the skipped pixels are never computed. */
+static bool DecodeScaledMjpeg(const uint8_t *data, unsigned long size, int scale_denom,
+                              uint8_t *argb, int width, int height) {
+    struct jpeg_decompress_struct cinfo;
+    JpegErrorManager jerr;
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = OnJpegError;
+    jerr.pub.output_message = OnJpegMessage;
+    jpeg_create_decompress(&cinfo);
+    if (setjmp(jerr.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_mem_src(&cinfo, data, size);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = scale_denom;
+    cinfo.out_color_space = JCS_EXT_BGRA;
+    cinfo.dct_method = JDCT_IFAST;
+    jpeg_start_decompress(&cinfo);
+    if ((int)cinfo.output_width != width || (int)cinfo.output_height != height) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = argb + cinfo.output_scanline * width * 4;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
 
 rtc::scoped_refptr<V4L2FrameBuffer> V4L2FrameBuffer::Create(int width, int height, int size,
                                                             uint32_t format) {
@@ -16,6 +63,12 @@ rtc::scoped_refptr<V4L2FrameBuffer> V4L2FrameBuffer::Create(int width, int heigh
     return rtc::make_ref_counted<V4L2FrameBuffer>(width, height, buffer, format);
 }
 
+rtc::scoped_refptr<V4L2FrameBuffer>
+V4L2FrameBuffer::Create(int width, int height, rtc::scoped_refptr<V4L2BufferLease> lease,
+                        uint32_t format) {
+    return rtc::make_ref_counted<V4L2FrameBuffer>(width, height, lease, format);
+}
+
 V4L2FrameBuffer::V4L2FrameBuffer(int width, int height, V4L2Buffer buffer, uint32_t format)
     : width_(width),
       height_(height),
@@ -24,8 +77,20 @@ V4L2FrameBuffer::V4L2FrameBuffer(int width, int height, V4L2Buffer buffer, uint3
       flags_(buffer.flags),
       timestamp_(buffer.timestamp),
       buffer_(buffer),
+      is_buffer_copied(false) {}
+
+// The frame points into the leased driver buffer, which is only re-queued when the frame is freed.
+V4L2FrameBuffer::V4L2FrameBuffer(int width, int height, rtc::scoped_refptr<V4L2BufferLease> lease,
+                                 uint32_t format)
+    : width_(width),
+      height_(height),
+      format_(format),
+      size_(lease->buffer().length),
+      flags_(lease->buffer().flags),
+      timestamp_(lease->buffer().timestamp),
+      buffer_(lease->buffer()),
       is_buffer_copied(false),
-      data_(static_cast<uint8_t *>(webrtc::AlignedMalloc(size_, kBufferAlignment))) {}
+      lease_(lease) {}
 
 V4L2FrameBuffer::V4L2FrameBuffer(int width, int height, int size, uint32_t format)
     : width_(width),
@@ -34,8 +99,8 @@ V4L2FrameBuffer::V4L2FrameBuffer(int width, int height, int size, uint32_t forma
       size_(size),
       flags_(0),
       timestamp_({0, 0}),
-      is_buffer_copied(false),
-      data_(static_cast<uint8_t *>(webrtc::AlignedMalloc(size_, kBufferAlignment))) {}
+      is_buffer_copied(true),
+      data_(FrameDataPool::Shared()->Acquire(size_)) {}
 
 V4L2FrameBuffer::~V4L2FrameBuffer() {}
 
@@ -54,33 +119,111 @@ unsigned int V4L2FrameBuffer::flags() const { return flags_; }
 timeval V4L2FrameBuffer::timestamp() const { return timestamp_; }
 
 rtc::scoped_refptr<webrtc::I420BufferInterface> V4L2FrameBuffer::ToI420() {
-    rtc::scoped_refptr<webrtc::I420Buffer> i420_buffer(webrtc::I420Buffer::Create(width_, height_));
-    i420_buffer->InitializeData();
+    std::lock_guard<std::mutex> lock(i420_mutex_);
+    if (!i420_buffer_) {
+        i420_buffer_ = ConvertToI420();
+    }
+    return i420_buffer_;
+}
+
+rtc::scoped_refptr<webrtc::I420BufferInterface> V4L2FrameBuffer::ToI420(int width, int height) {
+    if (width == width_ && height == height_) {
+        return ToI420();
+    }
+
+    std::lock_guard<std::mutex> lock(i420_mutex_);
+    for (auto &buffer : scaled_buffers_) {
+        if (buffer->width() == width && buffer->height() == height) {
+            return buffer;
+        }
+    }
+    auto scaled_buffer = ConvertToI420(width, height);
+    scaled_buffers_.push_back(scaled_buffer);
+    return scaled_buffer;
+}
+
+rtc::scoped_refptr<webrtc::I420BufferInterface> V4L2FrameBuffer::ConvertToI420() {
+    // Every path below overwrites the planes, so pooled buffers skip the zero-fill.
+    rtc::scoped_refptr<webrtc::I420Buffer> i420_buffer(
+        I420BufferPool::Shared().Create(width_, height_));
 
     if (format_ == V4L2_PIX_FMT_MJPEG) {
-        if (libyuv::ConvertToI420(is_buffer_copied ? data_.get() : (uint8_t *)buffer_.start, size_,
+        if (libyuv::ConvertToI420((const uint8_t *)Data(), size_,
                                   i420_buffer.get()->MutableDataY(), i420_buffer.get()->StrideY(),
                                   i420_buffer.get()->MutableDataU(), i420_buffer.get()->StrideU(),
                                   i420_buffer.get()->MutableDataV(), i420_buffer.get()->StrideV(),
                                   0, 0, width_, height_, width_, height_, libyuv::kRotate0,
                                   libyuv::FOURCC_MJPG) < 0) {
             ERROR_PRINT("Mjpeg ConvertToI420 Failed");
+            i420_buffer->InitializeData();
         }
     } else if (format_ == V4L2_PIX_FMT_YUV420) {
-        memcpy(i420_buffer->MutableDataY(),
-               is_buffer_copied ? data_.get() : (uint8_t *)buffer_.start, size_);
+        memcpy(i420_buffer->MutableDataY(), Data(), size_);
     } else if (format_ == V4L2_PIX_FMT_H264) {
         // use hw decoded frame from track.
+        i420_buffer->InitializeData();
     }
 
     return i420_buffer;
 }
 
+rtc::scoped_refptr<webrtc::I420BufferInterface> V4L2FrameBuffer::ConvertToI420(int width,
+                                                                               int height) {
+    rtc::scoped_refptr<webrtc::I420BufferInterface> source;
+
+    // pick the strongest DCT reduction that still covers the requested size.
+    int scale_denom = 1;
+    while (scale_denom < 8 && (width_ + scale_denom * 2 - 1) / (scale_denom * 2) >= width &&
+           (height_ + scale_denom * 2 - 1) / (scale_denom * 2) >= height) {
+        scale_denom *= 2;
+    }
+
+    if (format_ == V4L2_PIX_FMT_MJPEG && scale_denom > 1) {
+        int decoded_width = (width_ + scale_denom - 1) / scale_denom;
+        int decoded_height = (height_ + scale_denom - 1) / scale_denom;
+        auto argb = FrameDataPool::Shared()->Acquire(decoded_width * decoded_height * 4);
+        if (DecodeScaledMjpeg((const uint8_t *)Data(), size_, scale_denom, argb.get(),
+                              decoded_width, decoded_height)) {
+            auto decoded = I420BufferPool::Shared().Create(decoded_width, decoded_height);
+            libyuv::ARGBToI420(argb.get(), decoded_width * 4, decoded->MutableDataY(),
+                               decoded->StrideY(), decoded->MutableDataU(), decoded->StrideU(),
+                               decoded->MutableDataV(), decoded->StrideV(), decoded_width,
+                               decoded_height);
+            if (decoded_width == width && decoded_height == height) {
+                return decoded;
+            }
+            source = decoded;
+        } else {
+            ERROR_PRINT("Mjpeg scaled decode failed, fall back to full size");
+        }
+    }
+
+    if (!source) {
+        if (!i420_buffer_) {
+            i420_buffer_ = ConvertToI420();
+        }
+        source = i420_buffer_;
+    }
+
+    auto scaled_buffer = I420BufferPool::Shared().Create(width, height);
+    scaled_buffer->ScaleFrom(*source);
+    return scaled_buffer;
+}
+
+bool V4L2FrameBuffer::is_leased() const { return lease_ != nullptr; }
+
 void V4L2FrameBuffer::CopyBufferData() {
+    if (lease_ || is_buffer_copied) {
+        return;
+    }
+    // Only frames that outlive the driver buffer pay for a copy, the block comes from the pool.
+    data_ = FrameDataPool::Shared()->Acquire(size_);
     memcpy(data_.get(), (uint8_t *)buffer_.start, size_);
     is_buffer_copied = true;
 }
 
 V4L2Buffer V4L2FrameBuffer::GetRawBuffer() { return buffer_; }
 
-const void *V4L2FrameBuffer::Data() const { return data_.get(); }
+const void *V4L2FrameBuffer::Data() const {
+    return is_buffer_copied ? data_.get() : buffer_.start;
+}
@@ -1,15 +1,17 @@
 #ifndef V4L2_FRAME_BUFFER_H_
 #define V4L2_FRAME_BUFFER_H_
 
+#include "common/frame_buffer_pool.h"
+#include "common/v4l2_buffer_pool.h"
 #include "common/v4l2_utils.h"
 
 #include <linux/videodev2.h>
+#include <mutex>
 #include <vector>
 
 #include <api/video/i420_buffer.h>
 #include <api/video/video_frame.h>
 #include <common_video/include/video_frame_buffer.h>
-#include <rtc_base/memory/aligned_malloc.h>
 
 class V4L2FrameBuffer : public webrtc::VideoFrameBuffer {
   public:
@@ -17,17 +19,23 @@ class V4L2FrameBuffer : public webrtc::VideoFrameBuffer {
                                                       uint32_t format);
     static rtc::scoped_refptr<V4L2FrameBuffer> Create(int width, int height, V4L2Buffer buffer,
                                                       uint32_t format);
+    static rtc::scoped_refptr<V4L2FrameBuffer>
+    Create(int width, int height, rtc::scoped_refptr<V4L2BufferLease> lease, uint32_t format);
 
     Type type() const override;
     int width() const override;
     int height() const override;
+    // Conversions are computed once per frame and shared by every consumer.
     rtc::scoped_refptr<webrtc::I420BufferInterface> ToI420() override;
+    // A downscaled MJPEG frame is decoded at reduced size through the JPEG DCT scaling.
+    rtc::scoped_refptr<webrtc::I420BufferInterface> ToI420(int width, int height);
 
     uint32_t format() const;
     unsigned int size() const;
     unsigned int flags() const;
     timeval timestamp() const;
 
+    bool is_leased() const;
     void CopyBufferData();
     const void *Data() const;
     V4L2Buffer GetRawBuffer();
@@ -35,6 +43,8 @@ class V4L2FrameBuffer : public webrtc::VideoFrameBuffer {
   protected:
     V4L2FrameBuffer(int width, int height, int size, uint32_t format);
     V4L2FrameBuffer(int width, int height, V4L2Buffer buffer, uint32_t format);
+    V4L2FrameBuffer(int width, int height, rtc::scoped_refptr<V4L2BufferLease> lease,
+                    uint32_t format);
     ~V4L2FrameBuffer() override;
 
   private:
@@ -46,7 +56,15 @@ class V4L2FrameBuffer : public webrtc::VideoFrameBuffer {
     bool is_buffer_copied;
     timeval timestamp_;
     V4L2Buffer buffer_;
-    const std::unique_ptr<uint8_t, webrtc::AlignedFreeDeleter> data_;
+    rtc::scoped_refptr<V4L2BufferLease> lease_;
+    FrameDataPool::Block data_;
+
+    std::mutex i420_mutex_;
+    rtc::scoped_refptr<webrtc::I420BufferInterface> i420_buffer_;
+    std::vector<rtc::scoped_refptr<webrtc::I420BufferInterface>> scaled_buffers_;
+
+    rtc::scoped_refptr<webrtc::I420BufferInterface> ConvertToI420();
+    rtc::scoped_refptr<webrtc::I420BufferInterface> ConvertToI420(int width, int height);
 };
 
 #endif // V4L2_FRAME_BUFFER_H_
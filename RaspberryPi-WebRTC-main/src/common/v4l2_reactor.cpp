@@ -0,0 +1,153 @@
+#include "common/v4l2_reactor.h"
+#include "common/logging.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <rtc_base/time_utils.h>
+
+static const int kMaxEvents = 16;
+static const uint64_t kWakeId = 0;
+// a sixth of a 30 fps frame interval, every device on the thread shares the rest.
+static const int64_t kHandlerBudgetUs = 5000;
+static const int64_t kOverrunReportIntervalUs = 1000000;
+
+std::shared_ptr<V4L2Reactor> V4L2Reactor::Shared() {
+    static std::mutex mutex;
+    static std::weak_ptr<V4L2Reactor> shared;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto reactor = shared.lock();
+    if (!reactor) {
+        reactor = std::make_shared<V4L2Reactor>();
+        shared = reactor;
+    }
+    return reactor;
+}
+
+V4L2Reactor::V4L2Reactor()
+    : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+      wake_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      next_id_(kWakeId + 1),
+      dispatching_id_(kWakeId),
+      abort_(false) {
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        ERROR_PRINT("v4l2 reactor: %s", strerror(errno));
+        exit(-1);
+    }
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = kWakeId;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+    thread_ = rtc::PlatformThread::SpawnJoinable(
+        [this]() {
+            Loop();
+        },
+        "V4L2Reactor", rtc::ThreadAttributes().SetPriority(rtc::ThreadPriority::kHigh));
+}
+
+V4L2Reactor::~V4L2Reactor() {
+    abort_.store(true);
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+        ERROR_PRINT("v4l2 reactor wake up: %s", strerror(errno));
+    }
+    thread_.Finalize();
+
+    close(wake_fd_);
+    close(epoll_fd_);
+    DEBUG_PRINT("v4l2 reactor was released!");
+}
+
+bool V4L2Reactor::Register(int fd, uint32_t events, Handler handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t id = next_id_++;
+
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.u64 = id;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        ERROR_PRINT("fd(%d) register to reactor: %s", fd, strerror(errno));
+        return false;
+    }
+
+    entries_[id] = std::make_shared<Entry>(Entry{fd, std::move(handler), 0});
+    ids_[fd] = id;
+    return true;
+}
+
+void V4L2Reactor::Unregister(int fd) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = ids_.find(fd);
+    if (it == ids_.end()) {
+        return;
+    }
+    uint64_t id = it->second;
+    ids_.erase(it);
+    entries_.erase(id);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+
+    // a handler may unregister itself, otherwise wait for its running call to return.
+    if (std::this_thread::get_id() != thread_id_.load()) {
+        dispatched_.wait(lock, [this, id]() {
+            return dispatching_id_ != id;
+        });
+    }
+}
+
+void V4L2Reactor::Loop() {
+    thread_id_.store(std::this_thread::get_id());
+    epoll_event events[kMaxEvents];
+
+    while (!abort_.load()) {
+        int n = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+        if (n < 0) {
+            if (errno != EINTR) {
+                ERROR_PRINT("v4l2 reactor epoll_wait: %s", strerror(errno));
+            }
+            continue;
+        }
+
+        for (int i = 0; i < n && !abort_.load(); i++) {
+            uint64_t id = events[i].data.u64;
+            if (id == kWakeId) {
+                uint64_t count;
+                while (read(wake_fd_, &count, sizeof(count)) > 0) {
+                }
+                continue;
+            }
+
+            std::shared_ptr<Entry> entry;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = entries_.find(id);
+                if (it == entries_.end()) {
+                    continue; // unregistered after epoll_wait returned
+                }
+                entry = it->second;
+                dispatching_id_ = id;
+            }
+
+            int64_t start_us = rtc::TimeMicros();
+            entry->handler(events[i].events);
+            int64_t elapsed_us = rtc::TimeMicros() - start_us;
+            if (elapsed_us > kHandlerBudgetUs &&
+                start_us - entry->last_overrun_report_us > kOverrunReportIntervalUs) {
+                ERROR_PRINT("fd(%d) reactor handler took %lld us, over the %lld us budget",
+                            entry->fd, (long long)elapsed_us, (long long)kHandlerBudgetUs);
+                entry->last_overrun_report_us = start_us;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                dispatching_id_ = kWakeId;
+            }
+            dispatched_.notify_all();
+        }
+    }
+}
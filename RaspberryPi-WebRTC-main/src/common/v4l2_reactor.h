@@ -0,0 +1,57 @@
+#ifndef V4L2_REACTOR_H_
+#define V4L2_REACTOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <rtc_base/platform_thread.h>
+
+/* One epoll thread that waits on every V4L2 device (camera, decoder, scaler, encoder) and runs
+ * the handler registered for the ready fd. Handlers run one after another on the reactor thread,
+ * so a slow one delays every other device. A handler takes a single buffer per call and only
+ * hands it on: dequeue, queue into the next device or an async observer, requeue. Blocking on
+ * another device, software conversion or file i/o belong on the consumer's own thread. A call
+ * longer than 5 ms is logged with its fd, at most once a second per device. */
+class V4L2Reactor {
+  public:
+    using Handler = std::function<void(uint32_t events)>;
+
+    // The reactor shared by all devices, it stops when the last user releases it.
+    static std::shared_ptr<V4L2Reactor> Shared();
+
+    V4L2Reactor();
+    ~V4L2Reactor();
+
+    bool Register(int fd, uint32_t events, Handler handler);
+    // Once it returns, the handler of fd is not running and will not run again.
+    void Unregister(int fd);
+
+  private:
+    struct Entry {
+        int fd;
+        Handler handler;
+        int64_t last_overrun_report_us;
+    };
+
+    int epoll_fd_;
+    int wake_fd_;
+    uint64_t next_id_;
+    uint64_t dispatching_id_;
+    std::atomic<bool> abort_;
+    std::atomic<std::thread::id> thread_id_;
+    std::mutex mutex_;
+    std::condition_variable dispatched_;
+    std::unordered_map<uint64_t, std::shared_ptr<Entry>> entries_;
+    std::unordered_map<int, uint64_t> ids_;
+    rtc::PlatformThread thread_;
+
+    void Loop();
+};
+
+#endif // V4L2_REACTOR_H_
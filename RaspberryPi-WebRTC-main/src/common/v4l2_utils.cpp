@@ -235,8 +235,8 @@ void V4L2Util::UnMap(V4L2BufferGroup *gbuffer) {
     }
 }
 
-bool V4L2Util::MMap(int fd, V4L2BufferGroup *gbuffer) {
-    for (int i = 0; i < gbuffer->num_buffers; i++) {
+bool V4L2Util::MMap(int fd, V4L2BufferGroup *gbuffer, int from) {
+    for (int i = from; i < gbuffer->num_buffers; i++) {
         V4L2Buffer *buffer = &gbuffer->buffers[i];
         v4l2_buffer *inner = &buffer->inner;
         inner->type = gbuffer->type;
@@ -320,6 +320,65 @@ bool V4L2Util::AllocateBuffer(int fd, V4L2BufferGroup *gbuffer, int num_buffers)
     return true;
 }
 
+bool V4L2Util::CreateBuffers(int fd, V4L2BufferGroup *gbuffer, int count) {
+    v4l2_create_buffers create = {};
+    create.count = count;
+    create.memory = gbuffer->memory;
+    create.format.type = gbuffer->type;
+    if (ioctl(fd, VIDIOC_G_FMT, &create.format) < 0 ||
+        ioctl(fd, VIDIOC_CREATE_BUFS, &create) < 0) {
+        ERROR_PRINT("fd(%d) create buffers: %s", fd, strerror(errno));
+        return false;
+    }
+
+    int from = gbuffer->num_buffers;
+    // the driver can't drop single buffers, so ones added to a queue in use are left to the
+    // REQBUFS(0) in DeallocateBuffer(); only the mappings made here are undone.
+    auto release = [fd, gbuffer, from]() {
+        for (int i = from; i < gbuffer->num_buffers; i++) {
+            V4L2Buffer &buffer = gbuffer->buffers[i];
+            if (buffer.dmafd > 0) {
+                close(buffer.dmafd);
+            }
+            if (buffer.start != nullptr) {
+                munmap(buffer.start, buffer.length);
+            }
+        }
+        gbuffer->num_buffers = from;
+        gbuffer->buffers.resize(from);
+        if (from == 0) {
+            v4l2_requestbuffers req = {};
+            req.count = 0;
+            req.memory = gbuffer->memory;
+            req.type = gbuffer->type;
+            ioctl(fd, VIDIOC_REQBUFS, &req);
+        }
+    };
+
+    if (create.count == 0 || (int)create.index != from) {
+        ERROR_PRINT("fd(%d) created %u buffers at index %u, expected index %d", fd, create.count,
+                    create.index, from);
+        release();
+        return false;
+    }
+
+    gbuffer->num_buffers += create.count;
+    gbuffer->buffers.resize(gbuffer->num_buffers);
+
+    // resizing moved the buffers, re-point the planes of the existing ones.
+    for (int i = 0; i < from; i++) {
+        if (V4L2_TYPE_IS_MULTIPLANAR(gbuffer->type)) {
+            gbuffer->buffers[i].inner.m.planes = &gbuffer->buffers[i].plane;
+        }
+    }
+
+    if (gbuffer->memory == V4L2_MEMORY_MMAP && !MMap(fd, gbuffer, from)) {
+        release();
+        return false;
+    }
+    return true;
+}
+
 bool V4L2Util::DeallocateBuffer(int fd, V4L2BufferGroup *gbuffer) {
     if (gbuffer->memory == V4L2_MEMORY_MMAP) {
         V4L2Util::UnMap(gbuffer);
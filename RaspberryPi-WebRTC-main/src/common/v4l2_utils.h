@@ -61,8 +61,9 @@ class V4L2Util {
     static bool StreamOn(int fd, v4l2_buf_type type);
     static bool StreamOff(int fd, v4l2_buf_type type);
     static void UnMap(V4L2BufferGroup *gbuffer);
-    static bool MMap(int fd, V4L2BufferGroup *gbuffer);
+    static bool MMap(int fd, V4L2BufferGroup *gbuffer, int from = 0);
     static bool AllocateBuffer(int fd, V4L2BufferGroup *gbuffer, int num_buffers);
+    static bool CreateBuffers(int fd, V4L2BufferGroup *gbuffer, int count);
     static bool DeallocateBuffer(int fd, V4L2BufferGroup *gbuffer);
 };
 
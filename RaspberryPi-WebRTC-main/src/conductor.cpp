@@ -1,5 +1,7 @@
 #include "conductor.h"
 
+#include <algorithm>
+
 #include <api/audio_codecs/builtin_audio_decoder_factory.h>
 #include <api/audio_codecs/builtin_audio_encoder_factory.h>
 #include <api/create_peerconnection_factory.h>
@@ -22,9 +24,13 @@
 
 #include "capturer/libcamera_capturer.h"
 #include "capturer/v4l2_capturer.h"
+#include "codecs/v4l2/v4l2_h264_encoder.h"
 #include "common/logging.h"
 #include "common/utils.h"
 #include "customized_video_encoder_factory.h"
+#include "parser.h"
+#include "track/passthrough_track_source.h"
+#include "track/simulcast_track_source.h"
 #include "track/v4l2dma_track_source.h"
 
 std::shared_ptr<Conductor> Conductor::Create(Args args) {
@@ -41,7 +47,33 @@ Args Conductor::config() const { return args; }
 
 std::shared_ptr<PaCapturer> Conductor::AudioSource() const { return audio_capture_source_; }
 
-std::shared_ptr<VideoCapturer> Conductor::VideoSource() const { return video_capture_source_; }
+std::shared_ptr<VideoCapturer> Conductor::VideoSource() const {
+    return video_capture_sources_.empty() ? nullptr : video_capture_sources_.front();
+}
+
+std::vector<std::shared_ptr<VideoCapturer>> Conductor::VideoSources() const {
+    return video_capture_sources_;
+}
+
+std::vector<std::shared_ptr<MotionDetector>> Conductor::MotionDetectors() const {
+    return motion_detectors_;
+}
+
+Args Conductor::CameraConfig(int index) const {
+    if (index == 0) {
+        return args;
+    }
+
+    Args config = args;
+    config.camera = args.cameras[index];
+    Parser::ParseDevice(config);
+    // a sibling folder, the first camera's one only holds date folders.
+    if (!config.record_path.empty()) {
+        config.record_path.pop_back();
+        config.record_path += "_camera" + std::to_string(index) + "/";
+    }
+    return config;
+}
 
 void Conductor::InitializeTracks() {
     if (audio_track_ == nullptr && !args.no_audio) {
@@ -50,30 +82,55 @@ void Conductor::InitializeTracks() {
         audio_track_ = peer_connection_factory_->CreateAudioTrack("audio_track", options.get());
     }
 
-    if (video_track_ == nullptr && !args.camera.empty()) {
-        video_capture_source_ = ([this]() -> std::shared_ptr<VideoCapturer> {
-            if (args.use_libcamera) {
-                return LibcameraCapturer::Create(args);
+    if (args.hw_accel) {
+        V4L2EncoderPool::Shared()->SetMaxSessions(args.hw_encoders);
+    }
+
+    for (int i = video_tracks_.size(); i < static_cast<int>(args.cameras.size()); i++) {
+        Args config = CameraConfig(i);
+
+        auto capture_source = ([&config]() -> std::shared_ptr<VideoCapturer> {
+            if (config.use_libcamera) {
+                return LibcameraCapturer::Create(config);
             } else {
-                return V4L2Capturer::Create(args);
+                return V4L2Capturer::Create(config);
             }
         })();
 
-        video_track_source_ = ([this]() -> rtc::scoped_refptr<ScaleTrackSource> {
-            if (args.hw_accel) {
-                return V4L2DmaTrackSource::Create(video_capture_source_);
+        if (config.motion_detection) {
+            motion_detectors_.push_back(MotionDetector::Create(capture_source, config, i));
+        }
+
+        auto track_source = ([&config, capture_source]() -> rtc::scoped_refptr<ScaleTrackSource> {
+            if (config.h264_passthrough) {
+                return PassthroughTrackSource::Create(capture_source);
+            } else if (config.simulcast_layers > 1) {
+                return SimulcastTrackSource::Create(capture_source, config.simulcast_layers);
+            } else if (config.hw_accel) {
+                return V4L2DmaTrackSource::Create(capture_source);
             } else {
-                return ScaleTrackSource::Create(video_capture_source_);
+                return ScaleTrackSource::Create(capture_source);
             }
         })();
 
+        if (i == 0 && config.hw_accel && !config.h264_passthrough) {
+            // the first peer finds its encoder session already open.
+            V4L2EncoderPool::Shared()->Prewarm(config.width, config.height,
+                                               V4L2H264Encoder::IsDmaSource(config),
+                                               config.v4l2_h264_profile);
+        }
+
         auto video_source = webrtc::VideoTrackSourceProxy::Create(
-            signaling_thread_.get(), worker_thread_.get(), video_track_source_);
-        video_track_ = peer_connection_factory_->CreateVideoTrack(video_source, "video_track");
+            signaling_thread_.get(), worker_thread_.get(), track_source);
+        std::string track_id = i == 0 ? "video_track" : "video_track_" + std::to_string(i);
+        video_capture_sources_.push_back(capture_source);
+        video_track_sources_.push_back(track_source);
+        video_tracks_.push_back(peer_connection_factory_->CreateVideoTrack(video_source, track_id));
     }
 }
 
-void Conductor::AddTracks(rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection) {
+void Conductor::AddTracks(rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection,
+                          const std::vector<int> &cameras) {
     if (!peer_connection->GetSenders().empty()) {
         DEBUG_PRINT("Already add tracks.");
         return;
@@ -88,10 +145,15 @@ void Conductor::AddTracks(rtc::scoped_refptr<webrtc::PeerConnectionInterface> pe
         }
     }
 
-    if (video_track_) {
-        auto video_res = peer_connection->AddTrack(video_track_, {stream_id});
+    for (int i = 0; i < static_cast<int>(video_tracks_.size()); i++) {
+        if (!cameras.empty() && std::find(cameras.begin(), cameras.end(), i) == cameras.end()) {
+            continue;
+        }
+
+        auto video_res = peer_connection->AddTrack(video_tracks_[i], {stream_id});
         if (!video_res.ok()) {
             ERROR_PRINT("Failed to add video track, %s", video_res.error().message());
+            continue;
         }
 
         auto video_sender_ = video_res.value();
@@ -117,6 +179,7 @@ rtc::scoped_refptr<RtcPeer> Conductor::CreatePeerConnection(PeerConfig peer_conf
     }
 
     peer_config.timeout = args.peer_timeout;
+    auto cameras = peer_config.cameras;
     auto peer = RtcPeer::Create(std::move(peer_config));
     auto result = peer_connection_factory_->CreatePeerConnectionOrError(
         config, webrtc::PeerConnectionDependencies(peer.get()));
@@ -144,7 +207,15 @@ rtc::scoped_refptr<RtcPeer> Conductor::CreatePeerConnection(PeerConfig peer_conf
         OnCameraOption(datachannel, msg);
     });
 
-    AddTracks(peer->GetPeer());
+    peer->OnTriggerRecord([this](std::shared_ptr<DataChannelSubject> datachannel, std::string msg) {
+        OnTriggerRecord(datachannel, msg);
+    });
+
+    for (auto &detector : motion_detectors_) {
+        peer->OnActivity(detector->AsObservable());
+    }
+
+    AddTracks(peer->GetPeer(), cameras);
 
     DEBUG_PRINT("Peer connection(%s) is created! ", peer->GetId().c_str());
     return peer;
@@ -157,15 +228,53 @@ void Conductor::OnSnapshot(std::shared_ptr<DataChannelSubject> datachannel, std:
         ss >> num;
         int quality = ss.fail() ? 100 : num;
 
-        auto i420buff = video_capture_source_->GetI420Frame();
-        auto jpg_buffer =
-            Utils::ConvertYuvToJpeg(i420buff->DataY(), args.width, args.height, quality);
-        datachannel->Send(std::move(jpg_buffer));
+        // encoding runs on its own thread, the signaling thread only parses the request.
+        snapshot_thread_->PostTask([this, datachannel, quality]() {
+            auto jpg_buffer = CreateSnapshot(quality);
+            if (jpg_buffer.length > 0) {
+                datachannel->Send(std::move(jpg_buffer));
+            }
+        });
     } catch (const std::exception &e) {
         ERROR_PRINT("%s", e.what());
     }
 }
 
+Buffer Conductor::CreateSnapshot(int quality) {
+    if (args.h264_passthrough) {
+        // the frames are never decoded, there is no picture to take.
+        ERROR_PRINT("Snapshots are not available with h264_passthrough");
+        return {};
+    }
+
+    auto video_source = VideoSource();
+    if (!video_source) {
+        return {};
+    }
+
+    auto i420buff = video_source->GetI420Frame();
+    if (!i420buff) {
+        return {};
+    }
+
+    if (args.hw_accel) {
+        if (!jpeg_encoder_ || jpeg_encoder_->width() != i420buff->width() ||
+            jpeg_encoder_->height() != i420buff->height()) {
+            // the camera's resolution changed since the last snapshot.
+            jpeg_encoder_.reset();
+            jpeg_encoder_ = V4L2JpegEncoder::Create(i420buff->width(), i420buff->height(), quality);
+        }
+        if (jpeg_encoder_) {
+            auto jpg_buffer = jpeg_encoder_->Encode(*i420buff, quality);
+            if (jpg_buffer.length > 0) {
+                return jpg_buffer;
+            }
+        }
+    }
+
+    return Utils::ConvertYuvToJpeg(*i420buff, quality);
+}
+
 void Conductor::OnMetadata(std::shared_ptr<DataChannelSubject> datachannel, std::string &msg) {
     DEBUG_PRINT("OnMetadata msg: %s", msg.c_str());
     json jsonObj = json::parse(msg.c_str());
@@ -229,15 +338,42 @@ void Conductor::OnCameraOption(std::shared_ptr<DataChannelSubject> datachannel,
 
     int key = jsonObj["key"];
     int value = jsonObj["value"];
-    DEBUG_PRINT("parse meta cmd message => %d, %d", key, value);
+    int camera = jsonObj.value("camera", 0);
+    DEBUG_PRINT("parse meta cmd message => %d, %d (camera %d)", key, value, camera);
+
+    if (camera < 0 || camera >= static_cast<int>(video_capture_sources_.size())) {
+        ERROR_PRINT("Camera %d does not exist", camera);
+        return;
+    }
 
     try {
-        video_capture_source_->SetControls(key, value);
+        video_capture_sources_[camera]->SetControls(key, value);
     } catch (const std::exception &e) {
         ERROR_PRINT("%s", e.what());
     }
 }
 
+void Conductor::OnTriggerRecord(std::shared_ptr<DataChannelSubject> datachannel,
+                                std::string &msg) {
+    DEBUG_PRINT("OnTriggerRecord msg: %s", msg.c_str());
+    std::stringstream ss(msg);
+    int camera;
+    ss >> camera;
+    TriggerRecording(ss.fail() ? -1 : camera);
+}
+
+void Conductor::TriggerRecording(int camera) {
+    if (camera >= static_cast<int>(video_capture_sources_.size())) {
+        ERROR_PRINT("Camera %d does not exist", camera);
+        return;
+    }
+    record_trigger_.Next(camera);
+}
+
+std::shared_ptr<Observable<int>> Conductor::AsRecordTriggerObservable() {
+    return record_trigger_.AsObservable();
+}
+
 void Conductor::InitializePeerConnectionFactory() {
     rtc::InitializeSSL();
 
@@ -255,6 +391,11 @@ void Conductor::InitializePeerConnectionFactory() {
         DEBUG_PRINT("signaling thread start: success!");
     }
 
+    snapshot_thread_ = rtc::Thread::Create();
+    if (snapshot_thread_->Start()) {
+        DEBUG_PRINT("snapshot thread start: success!");
+    }
+
     webrtc::PeerConnectionFactoryDependencies dependencies;
     dependencies.network_thread = network_thread_.get();
     dependencies.worker_thread = worker_thread_.get();
@@ -278,7 +419,12 @@ void Conductor::InitializePeerConnectionFactory() {
     media_dependencies.audio_decoder_factory = webrtc::CreateBuiltinAudioDecoderFactory();
     media_dependencies.audio_processing = webrtc::AudioProcessingBuilder().Create();
     media_dependencies.audio_mixer = nullptr;
-    media_dependencies.video_encoder_factory = CreateCustomizedVideoEncoderFactory(args);
+    media_dependencies.video_encoder_factory = CreateCustomizedVideoEncoderFactory(args, [this]() {
+        // the pass-through serves a single camera.
+        if (auto video_source = VideoSource()) {
+            video_source->RequestKeyFrame();
+        }
+    });
     media_dependencies.video_decoder_factory = std::make_unique<webrtc::VideoDecoderFactoryTemplate<
         webrtc::OpenH264DecoderTemplateAdapter, webrtc::LibvpxVp8DecoderTemplateAdapter,
         webrtc::LibvpxVp9DecoderTemplateAdapter, webrtc::Dav1dDecoderTemplateAdapter>>();
@@ -289,9 +435,15 @@ void Conductor::InitializePeerConnectionFactory() {
 }
 
 Conductor::~Conductor() {
+    if (snapshot_thread_) {
+        snapshot_thread_->Stop();
+    }
+    jpeg_encoder_.reset();
     audio_track_ = nullptr;
-    video_track_ = nullptr;
-    video_capture_source_ = nullptr;
+    video_tracks_.clear();
+    video_track_sources_.clear();
+    motion_detectors_.clear();
+    video_capture_sources_.clear();
     peer_connection_factory_ = nullptr;
     rtc::CleanupSSL();
 }
@@ -6,13 +6,16 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <api/peer_connection_interface.h>
 #include <rtc_base/thread.h>
 
 #include "args.h"
+#include "capturer/motion_detector.h"
 #include "capturer/pa_capturer.h"
 #include "capturer/video_capturer.h"
+#include "codecs/v4l2/v4l2_jpeg_encoder.h"
 #include "rtc_peer.h"
 #include "track/scale_track_source.h"
 
@@ -27,29 +30,43 @@ class Conductor {
     rtc::scoped_refptr<RtcPeer> CreatePeerConnection(PeerConfig peer_config);
     std::shared_ptr<PaCapturer> AudioSource() const;
     std::shared_ptr<VideoCapturer> VideoSource() const;
+    std::vector<std::shared_ptr<VideoCapturer>> VideoSources() const;
+    // One per camera with `motion_detection`, otherwise empty.
+    std::vector<std::shared_ptr<MotionDetector>> MotionDetectors() const;
+    // Asks the event recorder of `camera`, or of every camera if it is negative, to record.
+    void TriggerRecording(int camera);
+    std::shared_ptr<Observable<int>> AsRecordTriggerObservable();
 
   private:
     Args args;
 
     void InitializePeerConnectionFactory();
     void InitializeTracks();
-    void AddTracks(rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection);
+    Args CameraConfig(int index) const;
+    void AddTracks(rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection,
+                   const std::vector<int> &cameras);
     void OnSnapshot(std::shared_ptr<DataChannelSubject> datachannel, std::string &msg);
+    Buffer CreateSnapshot(int quality);
     void OnMetadata(std::shared_ptr<DataChannelSubject> datachannel, std::string &path);
     void SendMetadata(std::shared_ptr<DataChannelSubject> datachannel, std::string &path);
     void OnRecord(std::shared_ptr<DataChannelSubject> datachannel, std::string &path);
     void OnCameraOption(std::shared_ptr<DataChannelSubject> datachannel, std::string &msg);
+    void OnTriggerRecord(std::shared_ptr<DataChannelSubject> datachannel, std::string &msg);
 
     std::unique_ptr<rtc::Thread> network_thread_;
     std::unique_ptr<rtc::Thread> worker_thread_;
     std::unique_ptr<rtc::Thread> signaling_thread_;
+    std::unique_ptr<rtc::Thread> snapshot_thread_;
+    std::unique_ptr<V4L2JpegEncoder> jpeg_encoder_;
 
     std::shared_ptr<PaCapturer> audio_capture_source_;
-    std::shared_ptr<VideoCapturer> video_capture_source_;
+    std::vector<std::shared_ptr<VideoCapturer>> video_capture_sources_;
+    std::vector<std::shared_ptr<MotionDetector>> motion_detectors_;
+    Subject<int> record_trigger_;
     rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> peer_connection_factory_;
     rtc::scoped_refptr<webrtc::AudioTrackInterface> audio_track_;
-    rtc::scoped_refptr<webrtc::VideoTrackInterface> video_track_;
-    rtc::scoped_refptr<ScaleTrackSource> video_track_source_;
+    std::vector<rtc::scoped_refptr<webrtc::VideoTrackInterface>> video_tracks_;
+    std::vector<rtc::scoped_refptr<ScaleTrackSource>> video_track_sources_;
 };
 
 #endif // CONDUCTOR_H_
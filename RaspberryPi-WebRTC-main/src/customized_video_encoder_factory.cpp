@@ -1,20 +1,36 @@
 #include "customized_video_encoder_factory.h"
+#include "codecs/h264/h264_passthrough_encoder.h"
 #include "codecs/v4l2/v4l2_h264_encoder.h"
+#include "codecs/v4l2/v4l2_shared_h264_encoder.h"
 
+#include <api/video_codecs/video_encoder_software_fallback_wrapper.h>
 #include <modules/video_coding/codecs/av1/av1_svc_config.h>
 #include <modules/video_coding/codecs/av1/libaom_av1_encoder.h>
 #include <modules/video_coding/codecs/h264/include/h264.h>
 #include <modules/video_coding/codecs/vp8/include/vp8.h>
 #include <modules/video_coding/codecs/vp9/include/vp9.h>
 
-std::unique_ptr<webrtc::VideoEncoderFactory> CreateCustomizedVideoEncoderFactory(Args args) {
-    return std::make_unique<CustomizedVideoEncoderFactory>(args);
+std::unique_ptr<webrtc::VideoEncoderFactory>
+CreateCustomizedVideoEncoderFactory(Args args, std::function<void()> request_key_frame) {
+    return std::make_unique<CustomizedVideoEncoderFactory>(args, request_key_frame);
 }
 
 std::vector<webrtc::SdpVideoFormat> CustomizedVideoEncoderFactory::GetSupportedFormats() const {
     std::vector<webrtc::SdpVideoFormat> supported_codecs;
 
-    if (args_.hw_accel) {
+    if (args_.h264_passthrough) {
+        // camera h264, access units are larger than a packet and need fu-a fragmentation.
+        supported_codecs.push_back(CreateH264Format(
+            webrtc::H264Profile::kProfileConstrainedBaseline, webrtc::H264Level::kLevel4, "1"));
+    } else if (args_.hw_accel &&
+               args_.v4l2_h264_profile != V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE) {
+        // hw h264, only the profile the encoder is set to.
+        auto profile = args_.v4l2_h264_profile == V4L2_MPEG_VIDEO_H264_PROFILE_HIGH
+                           ? webrtc::H264Profile::kProfileHigh
+                           : webrtc::H264Profile::kProfileMain;
+        supported_codecs.push_back(CreateH264Format(profile, webrtc::H264Level::kLevel4, "1"));
+        supported_codecs.push_back(CreateH264Format(profile, webrtc::H264Level::kLevel4, "0"));
+    } else if (args_.hw_accel) {
         // hw h264
         supported_codecs.push_back(CreateH264Format(
             webrtc::H264Profile::kProfileConstrainedBaseline, webrtc::H264Level::kLevel4, "1"));
@@ -47,8 +63,14 @@ std::vector<webrtc::SdpVideoFormat> CustomizedVideoEncoderFactory::GetSupportedF
 std::unique_ptr<webrtc::VideoEncoder>
 CustomizedVideoEncoderFactory::CreateVideoEncoder(const webrtc::SdpVideoFormat &format) {
     if (absl::EqualsIgnoreCase(format.name, cricket::kH264CodecName)) {
-        if (args_.hw_accel) {
-            return V4L2H264Encoder::Create(args_);
+        if (args_.h264_passthrough) {
+            return H264PassthroughEncoder::Create(request_key_frame_);
+        } else if (args_.hw_accel) {
+            // openh264 takes over once the pool has no hardware session left.
+            return webrtc::CreateVideoEncoderSoftwareFallbackWrapper(
+                webrtc::H264Encoder::Create(cricket::VideoCodec(format)),
+                args_.shared_encoder ? V4L2SharedH264Encoder::Create(args_)
+                                     : V4L2H264Encoder::Create(args_));
         } else {
             return webrtc::H264Encoder::Create(cricket::VideoCodec(format));
         }
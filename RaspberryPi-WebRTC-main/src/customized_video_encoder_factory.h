@@ -1,16 +1,20 @@
 #ifndef CUSTOMIZED_VIDEO_ENCODER_FACTORY_H_
 #define CUSTOMIZED_VIDEO_ENCODER_FACTORY_H_
 
+#include <functional>
+
 #include <api/video_codecs/video_encoder_factory.h>
 
 #include "args.h"
 
-std::unique_ptr<webrtc::VideoEncoderFactory> CreateCustomizedVideoEncoderFactory(Args args);
+std::unique_ptr<webrtc::VideoEncoderFactory>
+CreateCustomizedVideoEncoderFactory(Args args, std::function<void()> request_key_frame = nullptr);
 
 class CustomizedVideoEncoderFactory : public webrtc::VideoEncoderFactory {
   public:
-    CustomizedVideoEncoderFactory(Args args)
-        : args_(args){};
+    CustomizedVideoEncoderFactory(Args args, std::function<void()> request_key_frame)
+        : args_(args),
+          request_key_frame_(request_key_frame){};
     ~CustomizedVideoEncoderFactory() = default;
 
     std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override;
@@ -20,6 +24,7 @@ class CustomizedVideoEncoderFactory : public webrtc::VideoEncoderFactory {
 
   private:
     Args args_;
+    std::function<void()> request_key_frame_;
 };
 
 #endif // CUSTOMIZED_VIDEO_ENCODER_FACTORY_H_
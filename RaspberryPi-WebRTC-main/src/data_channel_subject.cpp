@@ -35,14 +35,12 @@ void DataChannelSubject::Next(std::string message) {
         if (content.empty()) {
             return;
         }
-        observers_ = observers_map_[type];
-        observers_.insert(observers_.end(), observers_map_[CommandType::UNKNOWN].begin(),
-                          observers_map_[CommandType::UNKNOWN].end());
-
-        for (auto &observer : observers_) {
-            if (observer->subscribed_func_ != nullptr) {
-                observer->subscribed_func_(content);
-            }
+        auto observers = observers_map_[type];
+        observers.insert(observers.end(), observers_map_[CommandType::UNKNOWN].begin(),
+                         observers_map_[CommandType::UNKNOWN].end());
+
+        for (auto &observer : observers) {
+            observer->Next(content);
         }
     } catch (const json::parse_error &e) {
         ERROR_PRINT("JSON parse error, %s, occur at position: %lu", e.what(), e.byte);
@@ -104,6 +102,10 @@ void DataChannelSubject::Send(const uint8_t *data, size_t size) {
     data_channel_->Send(data_buffer);
 }
 
+void DataChannelSubject::Send(RtcMessage message) {
+    Send(message.type, (uint8_t *)message.message.c_str(), message.message.length());
+}
+
 void DataChannelSubject::Send(MetaMessage metadata) {
     auto type = CommandType::METADATA;
     auto body = metadata.ToString();
@@ -20,6 +20,8 @@ enum class CommandType : uint8_t {
     METADATA,
     RECORD,
     CAMERA_OPTION,
+    ACTIVITY,
+    TRIGGER_RECORD,
     UNKNOWN
 };
 
@@ -85,6 +87,7 @@ class DataChannelSubject : public webrtc::DataChannelObserver,
     std::shared_ptr<Observable<std::string>> AsObservable(CommandType type);
     void UnSubscribe() override;
 
+    void Send(RtcMessage message);
     void Send(MetaMessage metadata);
     void Send(Buffer image);
     void Send(std::ifstream &file);
@@ -12,16 +12,34 @@ int main(int argc, char *argv[]) {
     Parser::ParseArgs(argc, argv, args);
 
     std::shared_ptr<Conductor> conductor = Conductor::Create(args);
-    std::unique_ptr<RecorderManager> recorder_mgr;
-
-    if (Utils::CreateFolder(args.record_path)) {
-        recorder_mgr =
-            RecorderManager::Create(conductor->VideoSource(), conductor->AudioSource(), args);
-        DEBUG_PRINT("Recorder is running!");
-    } else {
-        DEBUG_PRINT("Recorder is not started!");
+    std::vector<std::unique_ptr<RecorderManager>> recorder_mgrs;
+
+    // every camera records into its own folder, the audio goes with the first one.
+    auto video_sources = conductor->VideoSources();
+    auto motion_detectors = conductor->MotionDetectors();
+    for (int i = 0; i < video_sources.size(); i++) {
+        auto config = video_sources[i]->config();
+        if (!Utils::CreateFolder(config.record_path)) {
+            DEBUG_PRINT("Recorder is not started!");
+            break;
+        }
+        auto audio_source = i == 0 ? conductor->AudioSource() : nullptr;
+        auto motion = config.motion_record ? motion_detectors[i] : nullptr;
+        recorder_mgrs.push_back(
+            RecorderManager::Create(video_sources[i], audio_source, config, motion));
+        DEBUG_PRINT("Recorder is running! (%s)", config.record_path.c_str());
     }
 
+    // mqtt, the data channel or a feeder publishing to `<uid>/record` start event recordings.
+    auto record_trigger_observer = conductor->AsRecordTriggerObservable();
+    record_trigger_observer->Subscribe([&recorder_mgrs](int camera) {
+        for (int i = 0; i < recorder_mgrs.size(); i++) {
+            if (camera < 0 || camera == i) {
+                recorder_mgrs[i]->Trigger();
+            }
+        }
+    });
+
     boost::asio::io_context ioc_;
     boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_guard(
         ioc_.get_executor());
@@ -1,7 +1,9 @@
 #include "parser.h"
 
+#include <algorithm>
 #include <boost/program_options.hpp>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 namespace bpo = boost::program_options;
@@ -12,6 +14,18 @@ static const std::unordered_map<std::string, int> format_map = {
     {"i420", V4L2_PIX_FMT_YUV420},
 };
 
+static const std::unordered_map<std::string, int> bitrate_mode_map = {
+    {"vbr", V4L2_MPEG_VIDEO_BITRATE_MODE_VBR},
+    {"cbr", V4L2_MPEG_VIDEO_BITRATE_MODE_CBR},
+    {"cq", V4L2_MPEG_VIDEO_BITRATE_MODE_CQ},
+};
+
+static const std::unordered_map<std::string, int> h264_profile_map = {
+    {"baseline", V4L2_MPEG_VIDEO_H264_PROFILE_BASELINE},
+    {"main", V4L2_MPEG_VIDEO_H264_PROFILE_MAIN},
+    {"high", V4L2_MPEG_VIDEO_H264_PROFILE_HIGH},
+};
+
 template <typename T> void SetIfExists(bpo::variables_map &vm, const std::string &key, T &arg) {
     if (vm.count(key)) {
         arg = vm[key].as<T>();
@@ -35,9 +49,54 @@ void Parser::ParseArgs(int argc, char *argv[], Args &args) {
             "The connection timeout, in seconds, after receiving a remote offer")
         ("segment_duration", bpo::value<int>()->default_value(args.segment_duration),
             "The length (in seconds) of each MP4 recording.")
+        ("simulcast_layers", bpo::value<int>()->default_value(args.simulcast_layers),
+            "Serve 1-3 resolutions from one capture, each half the size of the previous. "
+            "Every peer receives the largest one its link can carry.")
+        ("capture_buffers", bpo::value<int>()->default_value(args.capture_buffers),
+            "Buffers the camera captures into. Frames held by slow consumers stay out of the "
+            "camera's queue, a deeper queue keeps high frame rates steady.")
+        ("bitrate_mode", bpo::value<std::string>()->default_value(args.bitrate_mode),
+            "Rate control of the hardware encoder, `vbr`, `cbr` or `cq`. In `cq` the qp range "
+            "alone decides the frame size and the peer's bandwidth estimate is ignored. An "
+            "encoder without `cq`, like the bcm2835, stays in `vbr`.")
+        ("min_qp", bpo::value<int>()->default_value(args.min_qp),
+            "The lowest qp (1-51) of the hardware encoder, 0 keeps the encoder's own limit")
+        ("max_qp", bpo::value<int>()->default_value(args.max_qp),
+            "The highest qp (1-51) of the hardware encoder, 0 keeps the encoder's own limit")
+        ("key_frame_interval", bpo::value<int>()->default_value(args.key_frame_interval),
+            "Frames between two idr frames of the hardware encoder")
+        ("intra_refresh", bpo::value<int>()->default_value(args.intra_refresh),
+            "Macroblocks intra coded per frame by the hardware encoder. When set, the picture is "
+            "refreshed gradually instead of by periodic idr frames, which avoids bitrate spikes.")
+        ("hw_encoders", bpo::value<int>()->default_value(args.hw_encoders),
+            "Hardware encoder sessions open at once across all cameras, peers and recorders, "
+            "0 leaves it to the driver. Encoders beyond the limit fall back to software.")
+        ("motion_detection", bpo::bool_switch()->default_value(args.motion_detection),
+            "Watch each camera for activity. Idle cameras capture at `idle_fps` and the "
+            "changes are sent to the peers' data channels and published over mqtt. An `h264` "
+            "camera needs `hw_accel`.")
+        ("motion_record", bpo::bool_switch()->default_value(args.motion_record),
+            "Record an event whenever a camera turns active, needs `motion_detection`")
+        ("event_record", bpo::bool_switch()->default_value(args.event_record),
+            "Keep the last `pre_roll` seconds in memory and write a file only when an event is "
+            "triggered over mqtt, the data channel or by motion, instead of recording all along")
+        ("pre_roll", bpo::value<int>()->default_value(args.pre_roll),
+            "Seconds before the trigger an event recording starts with")
+        ("post_roll", bpo::value<int>()->default_value(args.post_roll),
+            "Seconds an event recording goes on after the last trigger")
+        ("idle_fps", bpo::value<int>()->default_value(args.idle_fps),
+            "Frame rate of a camera without activity, 0 keeps the full rate")
+        ("motion_area", bpo::value<int>()->default_value(args.motion_area),
+            "Percent (1-100) of the picture that has to change to count as activity")
+        ("motion_hold", bpo::value<int>()->default_value(args.motion_hold),
+            "Seconds a camera stays active after the last motion")
+        ("h264_profile", bpo::value<std::string>()->default_value(args.h264_profile),
+            "Profile of the hardware encoder, `baseline`, `main` or `high`")
         ("camera", bpo::value<std::string>()->default_value(args.camera),
             "Specify the camera using V4L2 or Libcamera. "
-            "Examples: \"libcamera:0\" for Libcamera, \"v4l2:0\" for V4L2 at `/dev/video0`.")
+            "Examples: \"libcamera:0\" for Libcamera, \"v4l2:0\" for V4L2 at `/dev/video0`. "
+            "Several cameras are separated by commas, e.g. \"libcamera:0,v4l2:2\", each one "
+            "streams as its own track and records into its own folder.")
         ("fixed_resolution", bpo::bool_switch()->default_value(args.fixed_resolution),
             "Disable adaptive resolution scaling and keep a fixed resolution.")
         ("no_audio", bpo::bool_switch()->default_value(args.no_audio), "Run without audio source")
@@ -63,6 +122,13 @@ void Parser::ParseArgs(int argc, char *argv[], Args &args) {
             "The path to save the recording video files. The recorder won't start if it's empty")
         ("hw_accel", bpo::bool_switch()->default_value(args.hw_accel),
             "Share DMA buffers between decoder/scaler/encoder, which can decrease cpu usage")
+        ("shared_encoder", bpo::bool_switch()->default_value(args.shared_encoder),
+            "Encode each frame once in hardware and send it to every peer, needs `hw_accel`. "
+            "The bitrate is the lowest one among the peers")
+        ("h264_passthrough", bpo::bool_switch()->default_value(args.h264_passthrough),
+            "Send the camera's own h264 stream to peers without decoding or re-encoding it, "
+            "needs a `v4l2` camera with `v4l2_format` set to `h264`. Snapshots and recording "
+            "previews are not available in this mode")
         ("use_mqtt", bpo::bool_switch()->default_value(args.use_mqtt),
             "Use mqtt to exchange sdp and ice candidates")
         ("use_whep", bpo::bool_switch()->default_value(args.use_whep),
@@ -94,6 +160,20 @@ void Parser::ParseArgs(int argc, char *argv[], Args &args) {
     SetIfExists(vm, "rotation_angle", args.rotation_angle);
     SetIfExists(vm, "peer_timeout", args.peer_timeout);
     SetIfExists(vm, "segment_duration", args.segment_duration);
+    SetIfExists(vm, "simulcast_layers", args.simulcast_layers);
+    SetIfExists(vm, "capture_buffers", args.capture_buffers);
+    SetIfExists(vm, "bitrate_mode", args.bitrate_mode);
+    SetIfExists(vm, "min_qp", args.min_qp);
+    SetIfExists(vm, "max_qp", args.max_qp);
+    SetIfExists(vm, "key_frame_interval", args.key_frame_interval);
+    SetIfExists(vm, "intra_refresh", args.intra_refresh);
+    SetIfExists(vm, "hw_encoders", args.hw_encoders);
+    SetIfExists(vm, "idle_fps", args.idle_fps);
+    SetIfExists(vm, "motion_area", args.motion_area);
+    SetIfExists(vm, "motion_hold", args.motion_hold);
+    SetIfExists(vm, "pre_roll", args.pre_roll);
+    SetIfExists(vm, "post_roll", args.post_roll);
+    SetIfExists(vm, "h264_profile", args.h264_profile);
     SetIfExists(vm, "camera", args.camera);
     SetIfExists(vm, "v4l2_format", args.v4l2_format);
     SetIfExists(vm, "uid", args.uid);
@@ -109,8 +189,13 @@ void Parser::ParseArgs(int argc, char *argv[], Args &args) {
     SetIfExists(vm, "record_path", args.record_path);
 
     args.fixed_resolution = vm["fixed_resolution"].as<bool>();
+    args.motion_detection = vm["motion_detection"].as<bool>();
+    args.motion_record = vm["motion_record"].as<bool>();
+    args.event_record = vm["event_record"].as<bool>();
     args.no_audio = vm["no_audio"].as<bool>();
     args.hw_accel = vm["hw_accel"].as<bool>();
+    args.shared_encoder = vm["shared_encoder"].as<bool>();
+    args.h264_passthrough = vm["h264_passthrough"].as<bool>();
     args.use_mqtt = vm["use_mqtt"].as<bool>();
     args.use_whep = vm["use_whep"].as<bool>();
 
@@ -124,6 +209,76 @@ void Parser::ParseArgs(int argc, char *argv[], Args &args) {
         exit(1);
     }
 
+    if (args.shared_encoder && !args.hw_accel) {
+        std::cout << "The shared encoder needs `hw_accel`" << std::endl;
+        exit(1);
+    }
+
+    if (args.simulcast_layers < 1 || args.simulcast_layers > 3) {
+        std::cout << "Simulcast layers should be between 1 and 3" << std::endl;
+        exit(1);
+    }
+
+    if (args.capture_buffers < 2 || args.capture_buffers > VIDEO_MAX_FRAME) {
+        std::cout << "Capture buffers should be between 2 and " << VIDEO_MAX_FRAME << std::endl;
+        exit(1);
+    }
+
+    auto bitrate_mode = bitrate_mode_map.find(args.bitrate_mode);
+    if (bitrate_mode == bitrate_mode_map.end()) {
+        std::cout << "Bitrate mode should be `vbr`, `cbr` or `cq`" << std::endl;
+        exit(1);
+    }
+    args.v4l2_bitrate_mode = bitrate_mode->second;
+
+    auto h264_profile = h264_profile_map.find(args.h264_profile);
+    if (h264_profile == h264_profile_map.end()) {
+        std::cout << "H264 profile should be `baseline`, `main` or `high`" << std::endl;
+        exit(1);
+    }
+    args.v4l2_h264_profile = h264_profile->second;
+
+    if (args.min_qp < 0 || args.min_qp > 51 || args.max_qp < 0 || args.max_qp > 51 ||
+        (args.min_qp > 0 && args.max_qp > 0 && args.min_qp > args.max_qp)) {
+        std::cout << "The qp range should be within 1-51, or 0 to keep the encoder's own limit, "
+                     "and min_qp not above max_qp"
+                  << std::endl;
+        exit(1);
+    }
+
+    if (args.hw_encoders < 0) {
+        std::cout << "Hardware encoders should not be negative" << std::endl;
+        exit(1);
+    }
+
+    if (args.motion_record && !args.motion_detection) {
+        std::cout << "The motion record needs `motion_detection`" << std::endl;
+        exit(1);
+    }
+
+    if (args.motion_record) {
+        // motion is one more trigger of the event recording.
+        args.event_record = true;
+    }
+
+    if (args.pre_roll < 0 || args.post_roll < 0) {
+        std::cout << "Pre-roll and post-roll should not be negative" << std::endl;
+        exit(1);
+    }
+
+    if (args.idle_fps < 0 || args.motion_area < 1 || args.motion_area > 100 ||
+        args.motion_hold < 0) {
+        std::cout << "Idle fps and motion hold should not be negative, motion area within 1-100"
+                  << std::endl;
+        exit(1);
+    }
+
+    if (args.key_frame_interval < 1 || args.intra_refresh < 0) {
+        std::cout << "Key frame interval should be positive and intra refresh not negative"
+                  << std::endl;
+        exit(1);
+    }
+
     if (!args.record_path.empty()) {
         if (args.record_path.front() != '/') {
             std::cout << "The file path needs to start with a \"/\" character" << std::endl;
@@ -134,7 +289,53 @@ void Parser::ParseArgs(int argc, char *argv[], Args &args) {
         }
     }
 
+    args.cameras.clear();
+    std::stringstream cameras(args.camera);
+    std::string camera;
+    while (std::getline(cameras, camera, ',')) {
+        if (!camera.empty()) {
+            args.cameras.push_back(camera);
+        }
+    }
+    if (args.cameras.empty()) {
+        std::cout << "No camera is specified" << std::endl;
+        exit(1);
+    }
+    // the other cameras are parsed the same way once the conductor opens them.
+    args.camera = args.cameras.front();
     ParseDevice(args);
+
+    if (args.h264_passthrough && args.motion_detection) {
+        std::cout << "The h264 pass-through decodes no frames to detect motion on" << std::endl;
+        exit(1);
+    }
+
+    // only the hardware decoder turns an h264 camera's frames into a picture to compare.
+    bool has_h264_camera = std::any_of(args.cameras.begin(), args.cameras.end(),
+                                       [&args](const std::string &camera) {
+                                           return camera.rfind("v4l2:", 0) == 0 &&
+                                                  args.v4l2_format == "h264";
+                                       });
+    if (args.motion_detection && has_h264_camera && !args.hw_accel) {
+        std::cout << "Motion detection on an `h264` camera needs `hw_accel`" << std::endl;
+        exit(1);
+    }
+
+    if (args.cameras.size() > 1 && (args.shared_encoder || args.h264_passthrough)) {
+        std::cout << "The shared encoder and the h264 pass-through serve a single camera"
+                  << std::endl;
+        exit(1);
+    }
+
+    if (args.h264_passthrough && args.format != V4L2_PIX_FMT_H264) {
+        std::cout << "The h264 pass-through needs a `v4l2` camera in `h264` format" << std::endl;
+        exit(1);
+    }
+
+    if (args.h264_passthrough && args.simulcast_layers > 1) {
+        std::cout << "The h264 pass-through serves a single resolution" << std::endl;
+        exit(1);
+    }
 }
 
 void Parser::ParseDevice(Args &args) {
@@ -157,6 +358,8 @@ void Parser::ParseDevice(Args &args) {
         args.format = V4L2_PIX_FMT_YUV420;
         std::cout << "Using Libcamera, ID: " << args.cameraId << std::endl;
     } else if (prefix == "v4l2") {
+        // a config copied from a libcamera one must not keep its capturer.
+        args.use_libcamera = false;
         auto it = format_map.find(args.v4l2_format);
         if (it != format_map.end()) {
             args.format = it->second;
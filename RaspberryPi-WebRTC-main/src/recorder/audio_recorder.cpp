@@ -1,6 +1,11 @@
 #include "recorder/audio_recorder.h"
 #include "common/logging.h"
 
+#include <rtc_base/time_utils.h>
+
+// capture times jitter with the scheduling, only a larger gap to the sample count is corrected.
+const int MAX_DRIFT_FRAMES = 2;
+
 std::unique_ptr<AudioRecorder> AudioRecorder::Create(Args config) {
     auto ptr = std::make_unique<AudioRecorder>(config);
     ptr->InitializeFifoBuffer();
@@ -12,7 +17,8 @@ AudioRecorder::AudioRecorder(Args config)
       sample_rate(config.sample_rate),
       channels(2),
       sample_fmt(AV_SAMPLE_FMT_FLTP),
-      encoder_name("aac") {}
+      encoder_name("aac"),
+      next_pts_(-1) {}
 
 AudioRecorder::~AudioRecorder() {}
 
@@ -46,16 +52,29 @@ void AudioRecorder::InitializeFrame() {
     av_frame_make_writable(frame);
 }
 
-void AudioRecorder::InitializeFifoBuffer() { fifo_buffer.alloc(sample_fmt, channels, 1); }
+void AudioRecorder::InitializeFifoBuffer() {
+    fifo_buffer.alloc(sample_fmt, channels, 1, sample_rate);
+}
 
 void AudioRecorder::Encode() {
-    if (fifo_buffer.read((void **)&frame->data, frame_size) < 0) {
+    int64_t captured_us = 0;
+    if (fifo_buffer.read((void **)&frame->data, frame_size, &captured_us) <= 0) {
         DEBUG_PRINT("Failed to read audio data in fifo.");
         return;
     }
 
-    frame->pts = frame_count * frame->nb_samples;
-    frame_count++;
+    /* The pts follow the sample count, which runs on the sound card's clock. Video is timed by
+     * the capture clock, so the count is pulled back to it once the two drift apart: samples that
+     * went missing leave a gap, a frame ahead of the clock is dropped. */
+    int64_t capture_pts = av_rescale(captured_us, sample_rate, 1000000);
+    int64_t drift = capture_pts - next_pts_;
+    if (next_pts_ < 0 || drift > MAX_DRIFT_FRAMES * frame_size) {
+        next_pts_ = capture_pts;
+    } else if (drift < -MAX_DRIFT_FRAMES * frame_size) {
+        return;
+    }
+    frame->pts = next_pts_;
+    next_pts_ += frame_size;
 
     int ret = avcodec_send_frame(encoder, frame);
     if (ret < 0 || ret == AVERROR_EOF) {
@@ -73,10 +92,8 @@ void AudioRecorder::Encode() {
             break;
         }
 
-        pkt->stream_index = st->index;
-        pkt->pts = av_rescale_q(pkt->pts, encoder->time_base, st->time_base);
-        pkt->dts = av_rescale_q(pkt->dts, encoder->time_base, st->time_base);
-        pkt->duration = av_rescale_q(pkt->duration, encoder->time_base, st->time_base);
+        pkt->stream_index = stream_index;
+        av_packet_rescale_ts(pkt, encoder->time_base, AV_TIME_BASE_Q);
 
         OnPacketed(pkt);
 
@@ -104,10 +121,14 @@ void AudioRecorder::OnBuffer(PaBuffer &buffer) {
         }
     }
 
-    if (fifo_buffer.write(reinterpret_cast<void **>(converted_input_samples), samples_per_channel) <
-        samples_per_channel) {
+    // the buffer's last sample was captured about now.
+    if (fifo_buffer.write(reinterpret_cast<void **>(converted_input_samples), samples_per_channel,
+                          rtc::TimeMicros()) < samples_per_channel) {
         DEBUG_PRINT("Failed to write audio date into fifo buffer.");
     }
+    if (fifo_buffer.size() >= frame_size) {
+        Wakeup();
+    }
 
     if (converted_input_samples) {
         av_freep(&converted_input_samples[0]);
@@ -117,8 +138,9 @@ void AudioRecorder::OnBuffer(PaBuffer &buffer) {
 }
 
 bool AudioRecorder::ConsumeBuffer() {
+    uint32_t epoch = WakeupEpoch();
     if (fifo_buffer.size() < frame_size) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        WaitForWakeup(epoch);
         return false;
     }
     Encode();
@@ -126,6 +148,6 @@ bool AudioRecorder::ConsumeBuffer() {
 }
 
 void AudioRecorder::PreStart() {
-    frame_count = 0;
+    next_pts_ = -1;
     fifo_buffer.reset();
 }
@@ -14,25 +14,30 @@ extern "C" {
 #include "common/logging.h"
 #include "recorder/recorder.h"
 
+/* Also keeps when the newest sample was captured, so a read can tell when its first sample was. */
 class ThreadSafeAudioFifo {
   public:
-    void alloc(enum AVSampleFormat sample_fmt, int channels, int nb_samples) {
+    void alloc(enum AVSampleFormat sample_fmt, int channels, int nb_samples, int sample_rate) {
+        sample_rate_ = sample_rate;
         fifo_ = av_audio_fifo_alloc(sample_fmt, channels, nb_samples);
         if (fifo_ == nullptr) {
             DEBUG_PRINT("Failed to initialize audio fifo buffer.");
         }
     }
 
-    int write(void **data, int nb_samples) {
+    int write(void **data, int nb_samples, int64_t captured_us) {
         std::lock_guard<std::mutex> lock(mutex_);
+        last_captured_us_ = captured_us;
         return av_audio_fifo_write(fifo_, data, nb_samples);
     }
 
-    int read(void **data, int nb_samples) {
+    int read(void **data, int nb_samples, int64_t *captured_us) {
         std::lock_guard<std::mutex> lock(mutex_);
-        if (av_audio_fifo_size(fifo_) < nb_samples) {
+        int size = av_audio_fifo_size(fifo_);
+        if (size < nb_samples) {
             return 0;
         }
+        *captured_us = last_captured_us_ - av_rescale(size, 1000000, sample_rate_);
         return av_audio_fifo_read(fifo_, data, nb_samples);
     }
 
@@ -48,6 +53,8 @@ class ThreadSafeAudioFifo {
 
   private:
     AVAudioFifo *fifo_;
+    int sample_rate_ = 1;
+    int64_t last_captured_us_ = 0;
     std::mutex mutex_;
 };
 
@@ -63,7 +70,8 @@ class AudioRecorder : public Recorder<PaBuffer> {
     int sample_rate;
     int channels = 2;
     int frame_size;
-    unsigned int frame_count;
+    // in samples on the capture clock, negative until the first frame.
+    int64_t next_pts_;
     std::string encoder_name;
     ThreadSafeAudioFifo fifo_buffer;
     AVSampleFormat sample_fmt;
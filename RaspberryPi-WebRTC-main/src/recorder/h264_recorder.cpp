@@ -1,5 +1,18 @@
 #include "recorder/h264_recorder.h"
 
+// the software encoder reports no frame type, so the first slice tells whether it is an idr.
+static bool IsIdrFrame(const uint8_t *data, int size) {
+    for (int i = 0; i + 3 < size; i++) {
+        if (data[i] == 0x00 && data[i + 1] == 0x00 && data[i + 2] == 0x01) {
+            uint8_t nal_unit_type = data[i + 3] & 0x1F;
+            if (nal_unit_type == 1 || nal_unit_type == 5) {
+                return nal_unit_type == 5;
+            }
+        }
+    }
+    return false;
+}
+
 std::unique_ptr<H264Recorder> H264Recorder::Create(Args config) {
     return std::make_unique<H264Recorder>(config, "h264_v4l2m2m");
 }
@@ -19,7 +32,7 @@ void H264Recorder::Encode(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
     }
 
     auto i420_buffer = frame_buffer->ToI420();
-    if (config.hw_accel) {
+    if (encoder_) {
         unsigned int i420_buffer_size =
             (i420_buffer->StrideY() * frame_buffer->height()) +
             ((i420_buffer->StrideY() + 1) / 2) * ((frame_buffer->height() + 1) / 2) * 2;
@@ -32,7 +45,8 @@ void H264Recorder::Encode(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
         });
     } else {
         sw_encoder_->Encode(i420_buffer, [this, frame_buffer](uint8_t *encoded_buffer, int size) {
-            V4L2Buffer buffer((void *)encoded_buffer, size, frame_buffer->flags(),
+            V4L2Buffer buffer((void *)encoded_buffer, size,
+                              IsIdrFrame(encoded_buffer, size) ? V4L2_BUF_FLAG_KEYFRAME : 0,
                               frame_buffer->timestamp());
             OnEncoded(buffer);
         });
@@ -52,15 +66,16 @@ void H264Recorder::InitCodecs() {
     std::lock_guard<std::mutex> lock(mutex_);
 
     if (config.hw_accel) {
-        encoder_ = V4L2Encoder::Create(config.width, config.height, false);
+        encoder_ = V4L2EncoderPool::Shared()->Acquire(config.width, config.height, false);
+    }
+
+    if (encoder_) {
         encoder_->SetFps(config.fps);
+        encoder_->SetBitrateMode(V4L2_MPEG_VIDEO_BITRATE_MODE_VBR);
         encoder_->SetBitrate(config.width * config.height * config.fps * 0.1);
-        V4L2Util::SetExtCtrl(encoder_->GetFd(), V4L2_CID_MPEG_VIDEO_BITRATE_MODE,
-                             V4L2_MPEG_VIDEO_BITRATE_MODE_VBR);
-        V4L2Util::SetExtCtrl(encoder_->GetFd(), V4L2_CID_MPEG_VIDEO_H264_LEVEL,
-                             V4L2_MPEG_VIDEO_H264_LEVEL_4_0);
+        // files are cut and seeked on idr frames, so keep them frequent.
+        encoder_->SetGop(60);
         V4L2Util::SetExtCtrl(encoder_->GetFd(), V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME, 1);
-        V4L2Util::SetExtCtrl(encoder_->GetFd(), V4L2_CID_MPEG_VIDEO_H264_I_PERIOD, 60);
     } else {
         sw_encoder_ = Openh264Encoder::Create(config);
     }
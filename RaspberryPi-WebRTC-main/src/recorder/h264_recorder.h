@@ -5,7 +5,7 @@
 
 #include "codecs/h264/openh264_encoder.h"
 #include "codecs/v4l2/v4l2_decoder.h"
-#include "codecs/v4l2/v4l2_encoder.h"
+#include "codecs/v4l2/v4l2_encoder_pool.h"
 #include "recorder/video_recorder.h"
 
 class H264Recorder : public VideoRecorder {
@@ -22,7 +22,7 @@ class H264Recorder : public VideoRecorder {
   private:
     std::mutex mutex_;
     std::unique_ptr<V4L2Decoder> decoder_;
-    std::unique_ptr<V4L2Encoder> encoder_;
+    V4L2EncoderPool::Session encoder_;
     std::unique_ptr<Openh264Encoder> sw_encoder_;
 
     void InitCodecs();
@@ -0,0 +1,78 @@
+#include "recorder/pre_roll_buffer.h"
+#include "common/logging.h"
+
+#include <algorithm>
+
+PreRollBuffer::PreRollBuffer(int video_stream_index, int64_t duration_us, size_t max_bytes)
+    : video_stream_index_(video_stream_index),
+      duration_us_(duration_us),
+      max_bytes_(max_bytes),
+      bytes_(0),
+      latest_pts_(0) {}
+
+PreRollBuffer::~PreRollBuffer() { Clear(); }
+
+bool PreRollBuffer::IsKeyFrame(const AVPacket *pkt) const {
+    return pkt->stream_index == video_stream_index_ && (pkt->flags & AV_PKT_FLAG_KEY);
+}
+
+void PreRollBuffer::Push(const AVPacket *pkt) {
+    if (key_frame_pts_.empty() && !IsKeyFrame(pkt)) {
+        // nothing before the first key frame can be played back.
+        return;
+    }
+
+    // a copy, the encoder reuses the memory behind the packet.
+    AVPacket *copy = av_packet_clone(pkt);
+    if (!copy) {
+        return;
+    }
+    if (IsKeyFrame(copy)) {
+        key_frame_pts_.push_back(copy->pts);
+    }
+    packets_.push_back(copy);
+    bytes_ += copy->size;
+    latest_pts_ = std::max(latest_pts_, copy->pts);
+
+    Trim();
+}
+
+void PreRollBuffer::Trim() {
+    while (key_frame_pts_.size() > 1 &&
+           (key_frame_pts_[1] <= latest_pts_ - duration_us_ || bytes_ > max_bytes_)) {
+        PopGop();
+    }
+
+    if (bytes_ > max_bytes_) {
+        // the current gop alone is over the limit, it is dropped and the buffer starts over from
+        // the next key frame.
+        DEBUG_PRINT("Pre-roll gop exceeds %zu bytes, wait for the next key frame", max_bytes_);
+        Clear();
+    }
+}
+
+void PreRollBuffer::PopGop() {
+    key_frame_pts_.pop_front();
+    do {
+        bytes_ -= packets_.front()->size;
+        av_packet_free(&packets_.front());
+        packets_.pop_front();
+    } while (!packets_.empty() && !IsKeyFrame(packets_.front()));
+}
+
+void PreRollBuffer::Drain(std::function<void(AVPacket *pkt)> func) {
+    for (auto &pkt : packets_) {
+        func(pkt);
+    }
+    Clear();
+}
+
+void PreRollBuffer::Clear() {
+    for (auto &pkt : packets_) {
+        av_packet_free(&pkt);
+    }
+    packets_.clear();
+    key_frame_pts_.clear();
+    bytes_ = 0;
+    latest_pts_ = 0;
+}
@@ -0,0 +1,39 @@
+#ifndef PRE_ROLL_BUFFER_H_
+#define PRE_ROLL_BUFFER_H_
+
+#include <deque>
+#include <functional>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+/* Holds the latest encoded packets in memory, timed in microseconds. It is trimmed a whole gop at
+ * a time, so it always starts on a video key frame and a file written from it plays from its
+ * first frame. At least `duration_us` is kept, the byte limit bounds the memory at high bitrates.
+ * A single gop above the byte limit is dropped whole, until the next key frame nothing is kept. */
+class PreRollBuffer {
+  public:
+    PreRollBuffer(int video_stream_index, int64_t duration_us, size_t max_bytes);
+    ~PreRollBuffer();
+
+    void Push(const AVPacket *pkt);
+    // Hands every packet to `func` in order and empties the buffer.
+    void Drain(std::function<void(AVPacket *pkt)> func);
+    void Clear();
+
+  private:
+    int video_stream_index_;
+    int64_t duration_us_;
+    size_t max_bytes_;
+    size_t bytes_;
+    int64_t latest_pts_;
+    std::deque<AVPacket *> packets_;
+    std::deque<int64_t> key_frame_pts_;
+
+    bool IsKeyFrame(const AVPacket *pkt) const;
+    void Trim();
+    void PopGop();
+};
+
+#endif // PRE_ROLL_BUFFER_H_
@@ -26,9 +26,11 @@ void RawH264Recorder::PreStart() {
 }
 
 void RawH264Recorder::PostStop() {
-    // Wait P-frames are all consumed until I-frame appear.
-    auto frame = frame_buffer_queue.front();
-    while (frame && (frame.value()->flags() & V4L2_BUF_FLAG_KEYFRAME) != 0) {
+    // Write the queued P-frames of the last gop, up to the next I-frame.
+    while (auto frame = frame_buffer_queue.front()) {
+        if ((*frame)->flags() & V4L2_BUF_FLAG_KEYFRAME) {
+            break;
+        }
         ConsumeBuffer();
     }
     abort = true;
@@ -1,6 +1,7 @@
 #ifndef RECORDER_H_
 #define RECORDER_H_
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 
@@ -10,6 +11,7 @@ extern "C" {
 }
 
 #include "common/interface/subject.h"
+#include "common/lock_free_queue.h"
 #include "common/worker.h"
 
 template <typename T> class Recorder {
@@ -24,9 +26,15 @@ template <typename T> class Recorder {
     virtual void PostStop(){};
     virtual void PreStart(){};
 
+    // packets are timed in microseconds on the capture clock, the file they go into rescales them
+    // to its streams.
+    void SetStreamIndex(int index) { stream_index = index; }
+
     bool AddStream(AVFormatContext *output_fmt_ctx) {
-        avcodec_free_context(&encoder);
-        InitializeEncoderCtx(encoder);
+        // a running encoder is kept, so several files can follow each other.
+        if (!encoder) {
+            InitializeEncoderCtx(encoder);
+        }
         st = avformat_new_stream(output_fmt_ctx, encoder->codec);
         avcodec_parameters_from_context(st->codecpar, encoder);
 
@@ -36,12 +44,19 @@ template <typename T> class Recorder {
     void OnPacketed(OnPacketedFunc fn) { on_packeted = fn; }
 
     void Stop() {
+        // release a consumer waiting for data, then join it.
+        stopping_.store(true);
+        wakeup_.NotifyAll();
         worker.reset();
         avcodec_free_context(&encoder);
         PostStop();
     }
 
     void Start() {
+        if (!encoder) {
+            InitializeEncoderCtx(encoder);
+        }
+        stopping_.store(false);
         worker = std::make_unique<Worker>("Recorder", [this]() {
             ConsumeBuffer();
         });
@@ -52,8 +67,9 @@ template <typename T> class Recorder {
   protected:
     OnPacketedFunc on_packeted;
     std::unique_ptr<Worker> worker;
-    AVCodecContext *encoder;
-    AVStream *st;
+    AVCodecContext *encoder = nullptr;
+    AVStream *st = nullptr;
+    int stream_index = 0;
 
     virtual void InitializeEncoderCtx(AVCodecContext *&encoder) = 0;
     virtual bool ConsumeBuffer() = 0;
@@ -62,6 +78,20 @@ template <typename T> class Recorder {
             on_packeted(pkt);
         }
     }
+
+    /* Producers call Wakeup() after adding data. A consumer reads WakeupEpoch() before checking
+     * for data and passes it to WaitForWakeup(), so data added in between is not missed. */
+    uint32_t WakeupEpoch() const { return wakeup_.Epoch(); }
+    void WaitForWakeup(uint32_t epoch) {
+        if (!stopping_.load()) {
+            wakeup_.Wait(epoch);
+        }
+    }
+    void Wakeup() { wakeup_.NotifyOne(); }
+
+  private:
+    std::atomic<bool> stopping_{false};
+    QueueNotifier wakeup_;
 };
 
 #endif // RECORDER_H_
@@ -1,5 +1,6 @@
 #include "recorder/recorder_manager.h"
 
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <csignal>
@@ -18,6 +19,10 @@ const double SECOND_PER_FILE = 60.0;
 const unsigned long MIN_FREE_BYTE = 400 * 1024 * 1024;
 const char *CONTAINER_FORMAT = "mp4";
 const char *PREVIEW_IMAGE_EXTENSION = ".jpg";
+// bounds the pre-roll of a high bitrate camera, it drops whole gops beyond that.
+const size_t MAX_PRE_ROLL_BYTES = 32 * 1024 * 1024;
+// how long before the end of a segment the next file is opened.
+const int64_t NEXT_FILE_LEAD_US = 2000000;
 
 AVFormatContext *RecUtil::CreateContainer(const std::string &full_path) {
     AVFormatContext *fmt_ctx = nullptr;
@@ -56,7 +61,8 @@ void RecUtil::CloseContext(AVFormatContext *fmt_ctx) {
 
 std::unique_ptr<RecorderManager> RecorderManager::Create(std::shared_ptr<VideoCapturer> video_src,
                                                          std::shared_ptr<PaCapturer> audio_src,
-                                                         Args config) {
+                                                         Args config,
+                                                         std::shared_ptr<MotionDetector> motion) {
     auto instance = std::make_unique<RecorderManager>(config);
 
     if (video_src) {
@@ -67,6 +73,7 @@ std::unique_ptr<RecorderManager> RecorderManager::Create(std::shared_ptr<VideoCa
         instance->CreateAudioRecorder(audio_src);
         instance->SubscribeAudioSource(audio_src);
     }
+    instance->motion_ = motion;
 
     return instance;
 }
@@ -89,6 +96,8 @@ void RecorderManager::CreateAudioRecorder(std::shared_ptr<PaCapturer> capturer)
     audio_recorder = ([capturer]() -> std::unique_ptr<AudioRecorder> {
         return AudioRecorder::Create(capturer->config());
     })();
+    // streams are added to every file in the same order, video first.
+    audio_recorder->SetStreamIndex(video_recorder ? 1 : 0);
 }
 
 RecorderManager::RecorderManager(Args config)
@@ -96,31 +105,42 @@ RecorderManager::RecorderManager(Args config)
       fmt_ctx(nullptr),
       has_first_keyframe(false),
       record_path(config.record_path),
-      elapsed_time_(0.0) {}
+      file_start_us_(-1),
+      prev_fmt_ctx_(nullptr),
+      prev_start_us_(0),
+      prev_end_us_(0),
+      key_frame_requested_(false),
+      record_until_ms_(0) {
+    if (config.event_record) {
+        pre_roll_ = std::make_unique<PreRollBuffer>(0, config.pre_roll * 1000000LL,
+                                                    MAX_PRE_ROLL_BYTES);
+    }
+}
 
 void RecorderManager::SubscribeVideoSource(std::shared_ptr<VideoCapturer> video_src) {
-    video_observer = video_src->AsRawBufferObservable();
-    video_observer->Subscribe([this](V4L2Buffer buffer) {
-        // waiting first keyframe to start recorders.
-        if (!has_first_keyframe && ((buffer.flags & V4L2_BUF_FLAG_KEYFRAME) ||
-                                    video_src_->format() != V4L2_PIX_FMT_H264)) {
-            Start();
-            last_created_time_ = buffer.timestamp;
-        }
+    // recording runs on the observer's own thread, off the capture thread.
+    Observable<rtc::scoped_refptr<V4L2FrameBuffer>>::Options options;
+    options.queue_size = 8;
+    options.retain = [](rtc::scoped_refptr<V4L2FrameBuffer> &frame_buffer) {
+        frame_buffer->CopyBufferData();
+    };
 
-        // restart to write in the new file.
-        if (elapsed_time_ >= config.segment_duration && buffer.flags & V4L2_BUF_FLAG_KEYFRAME) {
-            last_created_time_ = buffer.timestamp;
-            Stop();
-            Start();
-        }
-
-        if (has_first_keyframe && video_recorder) {
-            video_recorder->OnBuffer(buffer);
-            elapsed_time_ = (buffer.timestamp.tv_sec - last_created_time_.tv_sec) +
-                            (buffer.timestamp.tv_usec - last_created_time_.tv_usec) / 1000000.0;
-        }
-    });
+    video_observer = video_src->AsRawBufferObservable();
+    video_observer->Subscribe(
+        [this](rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+            // waiting first keyframe to start recorders, they run from then on and the files
+            // are cut from their packets.
+            if (!has_first_keyframe && ((frame_buffer->flags() & V4L2_BUF_FLAG_KEYFRAME) ||
+                                        video_src_->format() != V4L2_PIX_FMT_H264)) {
+                StartRecorders();
+            }
+
+            if (has_first_keyframe && video_recorder) {
+                UpdateFile();
+                video_recorder->OnBuffer(frame_buffer);
+            }
+        },
+        options);
 
     video_recorder->OnPacketed([this](AVPacket *pkt) {
         this->WriteIntoFile(pkt);
@@ -142,18 +162,165 @@ void RecorderManager::SubscribeAudioSource(std::shared_ptr<PaCapturer> audio_src
 
 void RecorderManager::WriteIntoFile(AVPacket *pkt) {
     std::lock_guard<std::mutex> lock(ctx_mux);
-    int ret;
-    if (fmt_ctx && fmt_ctx->nb_streams > pkt->stream_index &&
-        (ret = av_interleaved_write_frame(fmt_ctx, pkt)) < 0) {
+    if (pre_roll_) {
+        pre_roll_->Push(pkt);
+    }
+    WritePacket(pkt);
+}
+
+void RecorderManager::WritePacket(AVPacket *pkt) {
+    if (prev_fmt_ctx_ && pkt->stream_index != 0) {
+        if (pkt->pts < prev_end_us_) {
+            // audio encoded before the cut still belongs to the previous file.
+            WriteIntoContext(prev_fmt_ctx_, prev_start_us_, pkt);
+            return;
+        }
+        FinalizeFile(prev_fmt_ctx_);
+        prev_fmt_ctx_ = nullptr;
+    }
+
+    if (!fmt_ctx || fmt_ctx->nb_streams <= pkt->stream_index) {
+        return;
+    }
+
+    bool is_key_frame = pkt->stream_index == 0 && (pkt->flags & AV_PKT_FLAG_KEY);
+    int64_t segment_us = config.segment_duration * 1000000LL;
+    int64_t lead_us = std::min(NEXT_FILE_LEAD_US, segment_us / 2);
+    if (file_start_us_ < 0) {
+        if (!is_key_frame) {
+            return;
+        }
+        file_start_us_ = pkt->pts;
+    } else if (pkt->stream_index == 0 && pkt->pts - file_start_us_ >= segment_us - lead_us) {
+        PrepareNextFile();
+        // the current file goes on until the next one is open.
+        bool is_due = pkt->pts - file_start_us_ >= segment_us && IsNextFileReady();
+        if (is_due && is_key_frame) {
+            RollOver(pkt->pts);
+        } else if (is_due && !key_frame_requested_ &&
+                   video_src_->format() == V4L2_PIX_FMT_H264) {
+            // the camera's gop can be far longer than the gap a segment may overrun by.
+            video_src_->RequestKeyFrame();
+            key_frame_requested_ = true;
+        }
+    }
+    if (pkt->pts < file_start_us_) {
+        // audio from before the first frame.
+        return;
+    }
+
+    WriteIntoContext(fmt_ctx, file_start_us_, pkt);
+}
+
+void RecorderManager::WriteIntoContext(AVFormatContext *ctx, int64_t start_us, AVPacket *pkt) {
+    AVStream *st = ctx->streams[pkt->stream_index];
+    pkt->pts = av_rescale_q(pkt->pts - start_us, AV_TIME_BASE_Q, st->time_base);
+    pkt->dts = av_rescale_q(pkt->dts - start_us, AV_TIME_BASE_Q, st->time_base);
+    pkt->duration = av_rescale_q(pkt->duration, AV_TIME_BASE_Q, st->time_base);
+
+    int ret = av_interleaved_write_frame(ctx, pkt);
+    if (ret < 0) {
         char err_buf[AV_ERROR_MAX_STRING_SIZE];
         av_strerror(ret, err_buf, sizeof(err_buf));
         fprintf(stderr, "Error occurred: %s\n", err_buf);
     }
 }
 
-void RecorderManager::Start() {
-    if (!Utils::CheckDriveSpace(record_path, MIN_FREE_BYTE)) {
-        auto task = std::async(std::launch::async, [this]() {
+void RecorderManager::PrepareNextFile() {
+    if (next_file_.valid()) {
+        return;
+    }
+    // opening a file and writing its header blocks on the disk, the packets don't wait for it.
+    next_file_ = std::async(std::launch::async, [this]() {
+        return CreateFile();
+    });
+}
+
+bool RecorderManager::IsNextFileReady() {
+    return next_file_.valid() &&
+           next_file_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void RecorderManager::RollOver(int64_t cut_us) {
+    AVFormatContext *next_fmt_ctx = next_file_.get();
+    if (next_fmt_ctx == nullptr) {
+        // keep writing into the current file, the next video packet opens another one.
+        return;
+    }
+
+    if (prev_fmt_ctx_) {
+        FinalizeFile(prev_fmt_ctx_);
+        prev_fmt_ctx_ = nullptr;
+    }
+    if (audio_recorder) {
+        prev_fmt_ctx_ = fmt_ctx;
+        prev_start_us_ = file_start_us_;
+        prev_end_us_ = cut_us;
+    } else {
+        FinalizeFile(fmt_ctx);
+    }
+
+    fmt_ctx = next_fmt_ctx;
+    file_start_us_ = cut_us;
+    key_frame_requested_ = false;
+    MakePreviewImage(fmt_ctx->url);
+}
+
+void RecorderManager::FinalizeFile(AVFormatContext *ctx, bool discard) {
+    // writing the trailer and moov of a long file takes a while, do it off the recorders'
+    // threads. Files are finished in order, each task waits for the one before.
+    auto previous = std::move(finalizing_);
+    finalizing_ = std::async(std::launch::async, [ctx, discard, previous = std::move(previous)]() {
+        if (previous.valid()) {
+            previous.wait();
+        }
+        std::string path = ctx->url;
+        RecUtil::CloseContext(ctx);
+        if (discard) {
+            // opened ahead but never written to.
+            std::filesystem::remove(path);
+        }
+    });
+}
+
+void RecorderManager::Trigger() {
+    if (!config.event_record) {
+        return;
+    }
+    record_until_ms_.store(rtc::TimeMillis() + config.post_roll * rtc::kNumMillisecsPerSec);
+}
+
+bool RecorderManager::IsFileOpen() {
+    std::lock_guard<std::mutex> lock(ctx_mux);
+    return fmt_ctx != nullptr;
+}
+
+void RecorderManager::UpdateFile() {
+    bool should_record = true;
+    if (config.event_record) {
+        if (motion_ && motion_->IsActive()) {
+            Trigger();
+        }
+        should_record = rtc::TimeMillis() < record_until_ms_.load();
+    }
+
+    bool is_open = IsFileOpen();
+    if (should_record && !is_open) {
+        if (config.event_record) {
+            INFO_PRINT("Event recording starts (%s)", record_path.c_str());
+        }
+        OpenFile();
+    } else if (!should_record && is_open) {
+        INFO_PRINT("Event recording ends (%s)", record_path.c_str());
+        CloseFile();
+    }
+}
+
+AVFormatContext *RecorderManager::CreateFile() {
+    if (!Utils::CheckDriveSpace(record_path, MIN_FREE_BYTE) &&
+        (!rotating_.valid() ||
+         rotating_.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+        rotating_ = std::async(std::launch::async, [this]() {
             Utils::RotateFiles(record_path);
         });
     }
@@ -162,26 +329,64 @@ void RecorderManager::Start() {
     auto folder = new_file.GetFolderPath();
     Utils::CreateFolder(folder);
 
-    {
-        std::lock_guard<std::mutex> lock(ctx_mux);
-        fmt_ctx = RecUtil::CreateContainer(new_file.GetFullPath());
-        if (fmt_ctx == nullptr) {
-            usleep(1000);
-            return;
-        }
+    AVFormatContext *ctx = RecUtil::CreateContainer(new_file.GetFullPath());
+    if (ctx == nullptr) {
+        usleep(1000);
+        return nullptr;
+    }
 
-        if (video_recorder) {
-            video_recorder->AddStream(fmt_ctx);
-        }
-        if (audio_recorder) {
-            audio_recorder->AddStream(fmt_ctx);
-        }
+    if (video_recorder) {
+        video_recorder->AddStream(ctx);
+    }
+    if (audio_recorder) {
+        audio_recorder->AddStream(ctx);
+    }
+
+    RecUtil::WriteFormatHeader(ctx);
+
+    av_dump_format(ctx, 0, new_file.GetFullPath().c_str(), 1);
+
+    return ctx;
+}
 
-        RecUtil::WriteFormatHeader(fmt_ctx);
+bool RecorderManager::OpenFile() {
+    std::lock_guard<std::mutex> lock(ctx_mux);
+    fmt_ctx = CreateFile();
+    if (fmt_ctx == nullptr) {
+        return false;
+    }
+    MakePreviewImage(fmt_ctx->url);
+
+    // a file starts at a key frame, with an event's pre-roll if there is one.
+    file_start_us_ = -1;
+    key_frame_requested_ = false;
+    if (pre_roll_) {
+        pre_roll_->Drain([this](AVPacket *pkt) {
+            WritePacket(pkt);
+        });
+    }
+    return true;
+}
 
-        av_dump_format(fmt_ctx, 0, new_file.GetFullPath().c_str(), 1);
+void RecorderManager::CloseFile() {
+    std::lock_guard<std::mutex> lock(ctx_mux);
+    if (next_file_.valid()) {
+        // wait for it, CreateFile() must not run twice at once.
+        if (auto next_fmt_ctx = next_file_.get()) {
+            FinalizeFile(next_fmt_ctx, true);
+        }
+    }
+    if (prev_fmt_ctx_) {
+        FinalizeFile(prev_fmt_ctx_);
+        prev_fmt_ctx_ = nullptr;
+    }
+    if (fmt_ctx) {
+        FinalizeFile(fmt_ctx);
+        fmt_ctx = nullptr;
     }
+}
 
+void RecorderManager::StartRecorders() {
     if (video_recorder) {
         video_recorder->Start();
     }
@@ -189,11 +394,14 @@ void RecorderManager::Start() {
         audio_recorder->Start();
     }
 
-    MakePreviewImage();
-
     has_first_keyframe = true;
 }
 
+void RecorderManager::Start() {
+    StartRecorders();
+    OpenFile();
+}
+
 void RecorderManager::Stop() {
     if (video_recorder) {
         video_recorder->Stop();
@@ -202,31 +410,35 @@ void RecorderManager::Stop() {
         audio_recorder->Stop();
     }
 
-    if (fmt_ctx) {
-        std::lock_guard<std::mutex> lock(ctx_mux);
-        RecUtil::CloseContext(fmt_ctx);
-        fmt_ctx = nullptr;
+    CloseFile();
+    if (finalizing_.valid()) {
+        finalizing_.wait();
     }
+    has_first_keyframe = false;
 }
 
 RecorderManager::~RecorderManager() {
     printf("~RecorderManager\n");
+    // stop the observers first, an async one may still be delivering into the recorders.
+    video_observer.reset();
+    audio_observer.reset();
     Stop();
     video_recorder.reset();
     audio_recorder.reset();
-    video_observer.reset();
-    audio_observer.reset();
 }
 
-void RecorderManager::MakePreviewImage() {
-    std::thread([this]() {
+void RecorderManager::MakePreviewImage(std::string url) {
+    if (config.h264_passthrough) {
+        // the frames are never decoded, a preview would come out flat grey.
+        return;
+    }
+    std::thread([this, url]() {
         std::this_thread::sleep_for(std::chrono::seconds(3));
         if (video_src_ == nullptr) {
             return;
         }
         auto i420buff = video_src_->GetI420Frame();
-        Utils::CreateJpegImage(i420buff->DataY(), i420buff->width(), i420buff->height(),
-                               ReplaceExtension(fmt_ctx->url, PREVIEW_IMAGE_EXTENSION),
+        Utils::CreateJpegImage(*i420buff, ReplaceExtension(url, PREVIEW_IMAGE_EXTENSION),
                                config.jpeg_quality);
     }).detach();
 }
@@ -1,6 +1,8 @@
 #ifndef RECORDER_MANAGER_H_
 #define RECORDER_MANAGER_H_
 
+#include <atomic>
+#include <future>
 #include <mutex>
 
 extern "C" {
@@ -10,10 +12,12 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
+#include "capturer/motion_detector.h"
 #include "capturer/pa_capturer.h"
 #include "capturer/video_capturer.h"
 #include "common/worker.h"
 #include "recorder/audio_recorder.h"
+#include "recorder/pre_roll_buffer.h"
 #include "recorder/video_recorder.h"
 
 class RecUtil {
@@ -27,12 +31,16 @@ class RecorderManager {
   public:
     static std::unique_ptr<RecorderManager> Create(std::shared_ptr<VideoCapturer> video_src,
                                                    std::shared_ptr<PaCapturer> audio_src,
-                                                   Args config);
+                                                   Args config,
+                                                   std::shared_ptr<MotionDetector> motion = nullptr);
     RecorderManager(Args config);
     ~RecorderManager();
     void WriteIntoFile(AVPacket *pkt);
     void Start();
     void Stop();
+    // records the event from `pre_roll` seconds ago until `post_roll` seconds after the last
+    // trigger. A continuous recording has everything already.
+    void Trigger();
 
   protected:
     std::mutex ctx_mux;
@@ -43,7 +51,7 @@ class RecorderManager {
     std::string record_path;
     AVFormatContext *fmt_ctx;
     bool has_first_keyframe;
-    std::shared_ptr<Observable<V4L2Buffer>> video_observer;
+    std::shared_ptr<Observable<rtc::scoped_refptr<V4L2FrameBuffer>>> video_observer;
     std::shared_ptr<Observable<PaBuffer>> audio_observer;
     std::unique_ptr<VideoRecorder> video_recorder;
     std::unique_ptr<AudioRecorder> audio_recorder;
@@ -54,11 +62,36 @@ class RecorderManager {
     void SubscribeAudioSource(std::shared_ptr<PaCapturer> aduio_src);
 
   private:
-    double elapsed_time_;
-    struct timeval last_created_time_;
+    // where the open file starts on the packets' clock, negative until its first key frame.
+    int64_t file_start_us_;
+    /* Packets of both streams are timed on the capture clock. After a rollover the previous file
+     * takes the audio from before the cut, then it's closed. */
+    AVFormatContext *prev_fmt_ctx_;
+    int64_t prev_start_us_;
+    int64_t prev_end_us_;
+    bool key_frame_requested_;
+    std::atomic<int64_t> record_until_ms_;
+    // opened ahead of a rollover, off the thread that writes the packets.
+    std::future<AVFormatContext *> next_file_;
+    std::future<void> finalizing_;
+    std::future<void> rotating_;
     std::shared_ptr<VideoCapturer> video_src_;
+    std::shared_ptr<MotionDetector> motion_;
+    std::unique_ptr<PreRollBuffer> pre_roll_;
 
-    void MakePreviewImage();
+    void StartRecorders();
+    AVFormatContext *CreateFile();
+    bool OpenFile();
+    void CloseFile();
+    void FinalizeFile(AVFormatContext *ctx, bool discard = false);
+    void PrepareNextFile();
+    bool IsNextFileReady();
+    bool IsFileOpen();
+    void UpdateFile();
+    void RollOver(int64_t cut_us);
+    void WritePacket(AVPacket *pkt);
+    void WriteIntoContext(AVFormatContext *ctx, int64_t start_us, AVPacket *pkt);
+    void MakePreviewImage(std::string url);
     std::string ReplaceExtension(const std::string &url, const std::string &new_extension);
 };
 
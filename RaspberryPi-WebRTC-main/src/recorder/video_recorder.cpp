@@ -2,6 +2,8 @@
 
 #include <memory>
 
+#include <rtc_base/time_utils.h>
+
 #include "common/utils.h"
 #include "recorder/h264_recorder.h"
 #include "recorder/raw_h264_recorder.h"
@@ -10,7 +12,9 @@ VideoRecorder::VideoRecorder(Args config, std::string encoder_name)
     : Recorder(),
       encoder_name(encoder_name),
       config(config),
-      abort(true) {}
+      abort(true),
+      frame_buffer_queue(8),
+      base_us_(0) {}
 
 void VideoRecorder::InitializeEncoderCtx(AVCodecContext *&encoder) {
     frame_rate = {.num = (int)config.fps, .den = 1};
@@ -25,29 +29,33 @@ void VideoRecorder::InitializeEncoderCtx(AVCodecContext *&encoder) {
     encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 }
 
-void VideoRecorder::OnBuffer(V4L2Buffer &buffer) {
-    if (frame_buffer_queue.size() < 8) {
-        rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer(
-            V4L2FrameBuffer::Create(config.width, config.height, buffer, config.format));
-        frame_buffer->CopyBufferData();
-        frame_buffer_queue.push(frame_buffer);
+void VideoRecorder::OnBuffer(rtc::scoped_refptr<V4L2FrameBuffer> &buffer) {
+    // leased frames keep the capture buffer until encoded, others get reused by the source.
+    buffer->CopyBufferData();
+    if (frame_buffer_queue.push(buffer)) {
+        Wakeup();
     }
 }
 
 void VideoRecorder::PostStop() { abort = true; }
 
-void VideoRecorder::SetBaseTimestamp(struct timeval time) { base_time_ = time; }
+void VideoRecorder::SetBaseTimestamp(struct timeval time) {
+    base_time_ = time;
+    // the camera's clock may have any origin, the first frame ties it to the one audio uses.
+    base_us_ = rtc::TimeMicros();
+}
 
 void VideoRecorder::OnEncoded(V4L2Buffer &buffer) {
     AVPacket *pkt = av_packet_alloc();
     pkt->data = static_cast<uint8_t *>(buffer.start);
     pkt->size = buffer.length;
-    pkt->stream_index = st->index;
+    pkt->stream_index = stream_index;
+    if (buffer.flags & V4L2_BUF_FLAG_KEYFRAME) {
+        pkt->flags |= AV_PKT_FLAG_KEY;
+    }
 
-    double elapsed_time = (buffer.timestamp.tv_sec - base_time_.tv_sec) +
-                          (buffer.timestamp.tv_usec - base_time_.tv_usec) / 1000000.0;
-    pkt->pts = pkt->dts =
-        static_cast<int64_t>(elapsed_time * st->time_base.den / st->time_base.num);
+    pkt->pts = pkt->dts = base_us_ + (buffer.timestamp.tv_sec - base_time_.tv_sec) * 1000000LL +
+                          (buffer.timestamp.tv_usec - base_time_.tv_usec);
 
     OnPacketed(pkt);
     av_packet_unref(pkt);
@@ -55,10 +63,11 @@ void VideoRecorder::OnEncoded(V4L2Buffer &buffer) {
 }
 
 bool VideoRecorder::ConsumeBuffer() {
+    uint32_t epoch = WakeupEpoch();
     auto item = frame_buffer_queue.pop();
 
     if (!item) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        WaitForWakeup(epoch);
         return false;
     }
 
@@ -10,22 +10,22 @@ extern "C" {
 
 #include "args.h"
 #include "codecs/v4l2/v4l2_decoder.h"
-#include "common/thread_safe_queue.h"
+#include "common/lock_free_queue.h"
 #include "common/v4l2_frame_buffer.h"
 #include "recorder/recorder.h"
 
-class VideoRecorder : public Recorder<V4L2Buffer> {
+class VideoRecorder : public Recorder<rtc::scoped_refptr<V4L2FrameBuffer>> {
   public:
     VideoRecorder(Args config, std::string encoder_name);
     virtual ~VideoRecorder(){};
-    void OnBuffer(V4L2Buffer &buffer) override;
+    void OnBuffer(rtc::scoped_refptr<V4L2FrameBuffer> &buffer) override;
     void PostStop() override;
 
   protected:
     Args config;
     std::atomic<bool> abort;
     std::string encoder_name;
-    ThreadSafeQueue<rtc::scoped_refptr<V4L2FrameBuffer>> frame_buffer_queue;
+    SpscQueue<rtc::scoped_refptr<V4L2FrameBuffer>> frame_buffer_queue;
 
     AVRational frame_rate;
 
@@ -37,6 +37,7 @@ class VideoRecorder : public Recorder<V4L2Buffer> {
 
   private:
     struct timeval base_time_;
+    int64_t base_us_;
     std::unique_ptr<V4L2Decoder> image_decoder_;
 
     void InitializeEncoderCtx(AVCodecContext *&encoder) override;
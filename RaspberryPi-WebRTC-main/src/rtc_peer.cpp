@@ -36,6 +36,7 @@ void RtcPeer::Terminate() {
         peer_connection_ = nullptr;
     }
     modified_desc_.release();
+    activity_observers_.clear();
     data_channel_subject_.reset();
 }
 
@@ -104,6 +105,25 @@ void RtcPeer::OnCameraOption(OnCommand func) {
     SubscribeCommandChannel(CommandType::CAMERA_OPTION, func);
 }
 
+void RtcPeer::OnTriggerRecord(OnCommand func) {
+    SubscribeCommandChannel(CommandType::TRIGGER_RECORD, func);
+}
+
+void RtcPeer::OnActivity(std::shared_ptr<Observable<MotionEvent>> observer) {
+    // sending may wait on a full channel, so it runs off the capture thread.
+    Observable<MotionEvent>::Options options;
+    options.queue_size = 4;
+    std::weak_ptr<DataChannelSubject> weak_channel = data_channel_subject_;
+    observer->Subscribe(
+        [weak_channel](MotionEvent event) {
+            if (auto datachannel = weak_channel.lock()) {
+                datachannel->Send(RtcMessage(CommandType::ACTIVITY, event.ToString()));
+            }
+        },
+        options);
+    activity_observers_.push_back(observer);
+}
+
 void RtcPeer::SubscribeCommandChannel(CommandType type, OnCommand func) {
     auto observer = data_channel_subject_->AsObservable(type);
     observer->Subscribe([this, func](std::string message) {
@@ -3,18 +3,22 @@
 
 #include <atomic>
 #include <thread>
+#include <vector>
 
 #include <api/data_channel_interface.h>
 #include <api/peer_connection_interface.h>
 #include <api/video/video_sink_interface.h>
 
 #include "args.h"
+#include "capturer/motion_detector.h"
 #include "common/logging.h"
 #include "data_channel_subject.h"
 
 struct PeerConfig {
     int timeout = 10;
     bool has_candidates_in_sdp = false;
+    // indices of the cameras to send, all of them when empty.
+    std::vector<int> cameras;
 };
 
 class SetSessionDescription : public webrtc::SetSessionDescriptionObserver {
@@ -94,6 +98,9 @@ class RtcPeer : public webrtc::PeerConnectionObserver,
     void OnMetadata(OnCommand func);
     void OnRecord(OnCommand func);
     void OnCameraOption(OnCommand func);
+    void OnTriggerRecord(OnCommand func);
+    // Sends the camera's activity events over the data channel while the peer lives.
+    void OnActivity(std::shared_ptr<Observable<MotionEvent>> observer);
 
     // SignalingMessageObserver implementation.
     void SetRemoteSdp(const std::string &sdp, const std::string &type) override;
@@ -132,6 +139,7 @@ class RtcPeer : public webrtc::PeerConnectionObserver,
     std::unique_ptr<webrtc::SessionDescriptionInterface> modified_desc_;
 
     std::shared_ptr<DataChannelSubject> data_channel_subject_;
+    std::vector<std::shared_ptr<Observable<MotionEvent>>> activity_observers_;
     rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection_;
     rtc::VideoSinkInterface<webrtc::VideoFrame> *custom_video_sink_;
 };
@@ -108,7 +108,8 @@ void HttpSession::HandleRequest() {
 
 void HttpSession::HandlePostRequest() {
     if (content_type_ == "application/sdp") {
-        auto peer = http_service_->CreatePeer();
+        auto cameras = ParseCameras(std::string(req_.target().data(), req_.target().size()));
+        auto peer = http_service_->CreatePeer(cameras);
         peer->OnLocalSdp([self = shared_from_this()](const std::string &peer_id,
                                                      const std::string &sdp,
                                                      const std::string &type) {
@@ -265,6 +266,28 @@ std::vector<std::string> HttpSession::ParseRoutes(std::string target) {
     return routes;
 }
 
+// reads the cameras a viewer asks for, e.g. `/whep?cameras=0,2`.
+std::vector<int> HttpSession::ParseCameras(std::string target) {
+    std::vector<int> cameras;
+    auto pos = target.find("cameras=");
+    if (pos == std::string::npos) {
+        return cameras;
+    }
+
+    std::string value = target.substr(pos + 8);
+    value = value.substr(0, value.find('&'));
+    std::string tmp;
+    std::stringstream ss(value);
+    while (std::getline(ss, tmp, ',')) {
+        try {
+            cameras.push_back(std::stoi(tmp));
+        } catch (const std::exception &e) {
+            ERROR_PRINT("Invalid camera index: %s", tmp.c_str());
+        }
+    }
+    return cameras;
+}
+
 IceCandidates HttpSession::ParseCandidates(const std::string &sdp) {
     std::regex midRegex(R"(a=mid:(\d+))");
     std::regex iceUfragRegex(R"(a=ice-ufrag:([^\s]+))");
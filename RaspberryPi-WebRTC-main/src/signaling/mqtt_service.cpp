@@ -26,7 +26,26 @@ MqttService::MqttService(Args args, std::shared_ptr<Conductor> conductor)
       password_(args.mqtt_password),
       sdp_base_topic_(GetTopic("sdp")),
       ice_base_topic_(GetTopic("ice")),
-      connection_(nullptr) {}
+      activity_topic_(GetTopic("activity")),
+      record_topic_(GetTopic("record")),
+      connection_(nullptr) {
+    SubscribeActivity(conductor);
+}
+
+void MqttService::SubscribeActivity(std::shared_ptr<Conductor> conductor) {
+    // publishing runs on the observers' own threads, the mosquitto loop thread sends it.
+    Observable<MotionEvent>::Options options;
+    options.queue_size = 4;
+    for (auto &detector : conductor->MotionDetectors()) {
+        auto observer = detector->AsObservable();
+        observer->Subscribe(
+            [this](MotionEvent event) {
+                Publish(activity_topic_, event.ToString());
+            },
+            options);
+        activity_observers_.push_back(observer);
+    }
+}
 
 std::string MqttService::GetTopic(const std::string &topic, const std::string &client_id) const {
     std::string result;
@@ -40,7 +59,10 @@ std::string MqttService::GetTopic(const std::string &topic, const std::string &c
     return result;
 }
 
-MqttService::~MqttService() { Disconnect(); }
+MqttService::~MqttService() {
+    activity_observers_.clear();
+    Disconnect();
+}
 
 void MqttService::OnRemoteSdp(const std::string &peer_id, const std::string &message) {
     nlohmann::json jsonObj = nlohmann::json::parse(message);
@@ -133,6 +155,7 @@ void MqttService::OnConnect(struct mosquitto *mosq, void *obj, int result) {
     if (result == 0) {
         Subscribe(sdp_base_topic_ + "/+/offer");
         Subscribe(ice_base_topic_ + "/+/offer");
+        Subscribe(record_topic_);
         DEBUG_PRINT("MQTT service is ready.");
     } else {
         // todo: retry connection on failure
@@ -142,11 +165,13 @@ void MqttService::OnConnect(struct mosquitto *mosq, void *obj, int result) {
 
 void MqttService::OnMessage(struct mosquitto *mosq, void *obj,
                             const struct mosquitto_message *message) {
-    if (!message->payload)
-        return;
-
     std::string topic(message->topic);
-    std::string payload(static_cast<char *>(message->payload));
+    // mosquitto hands an empty message over without a payload.
+    std::string payload = message->payload ? std::string(static_cast<char *>(message->payload),
+                                                         message->payloadlen)
+                                           : std::string();
+    if (payload.empty() && topic != record_topic_)
+        return;
 
     auto client_id = GetClientId(topic);
 
@@ -167,6 +192,12 @@ void MqttService::OnMessage(struct mosquitto *mosq, void *obj,
         OnRemoteSdp(client_id_to_peer_id_[client_id], payload);
     } else if (topic.starts_with(ice_base_topic_)) {
         OnRemoteIce(client_id_to_peer_id_[client_id], payload);
+    } else if (topic == record_topic_) {
+        // a camera index, anything else, an empty message too, records on every camera.
+        std::stringstream ss(payload);
+        int camera;
+        ss >> camera;
+        conductor_->TriggerRecording(ss.fail() ? -1 : camera);
     }
 }
 
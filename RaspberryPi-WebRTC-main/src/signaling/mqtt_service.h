@@ -5,6 +5,7 @@
 
 #include <memory>
 #include <mosquitto.h>
+#include <vector>
 
 #include "args.h"
 
@@ -28,11 +29,15 @@ class MqttService : public SignalingService {
     std::string password_;
     std::string sdp_base_topic_;
     std::string ice_base_topic_;
+    std::string activity_topic_;
+    std::string record_topic_;
     struct mosquitto *connection_;
+    std::vector<std::shared_ptr<Observable<MotionEvent>>> activity_observers_;
 
     std::unordered_map<std::string, std::string> client_id_to_peer_id_;
     std::unordered_map<std::string, std::string> peer_id_to_client_id_;
 
+    void SubscribeActivity(std::shared_ptr<Conductor> conductor);
     void OnRemoteSdp(const std::string &peer_id, const std::string &message);
     void OnRemoteIce(const std::string &peer_id, const std::string &message);
     void AnswerLocalSdp(const std::string &peer_id, const std::string &sdp,
@@ -20,9 +20,10 @@ class SignalingService {
         Connect();
     }
 
-    rtc::scoped_refptr<RtcPeer> CreatePeer() {
+    rtc::scoped_refptr<RtcPeer> CreatePeer(std::vector<int> cameras = {}) {
         PeerConfig config;
         config.has_candidates_in_sdp = has_candidates_in_sdp_;
+        config.cameras = std::move(cameras);
 
         auto peer = conductor_->CreatePeerConnection(std::move(config));
         peer_map_[peer->GetId()] = peer;
@@ -58,10 +59,11 @@ class SignalingService {
     virtual void Connect() = 0;
     virtual void Disconnect() = 0;
 
+    std::shared_ptr<Conductor> conductor_;
+
   private:
     bool has_candidates_in_sdp_;
     std::unique_ptr<Worker> worker_;
-    std::shared_ptr<Conductor> conductor_;
     std::unordered_map<std::string, rtc::scoped_refptr<RtcPeer>> peer_map_;
 };
 
@@ -0,0 +1,35 @@
+#include "track/passthrough_track_source.h"
+
+#include "common/v4l2_frame_buffer.h"
+
+rtc::scoped_refptr<PassthroughTrackSource>
+PassthroughTrackSource::Create(std::shared_ptr<VideoCapturer> capturer) {
+    auto obj = rtc::make_ref_counted<PassthroughTrackSource>(std::move(capturer));
+    obj->StartTrack();
+    return obj;
+}
+
+PassthroughTrackSource::PassthroughTrackSource(std::shared_ptr<VideoCapturer> capturer)
+    : ScaleTrackSource(capturer) {}
+
+PassthroughTrackSource::~PassthroughTrackSource() { observer.reset(); }
+
+void PassthroughTrackSource::StartTrack() {
+    // the frame holds the capture buffer's lease until the encoder has copied the access unit.
+    observer = capturer->AsRawBufferObservable();
+    observer->Subscribe([this](rtc::scoped_refptr<V4L2FrameBuffer> raw_buffer) {
+        OnFrameCaptured(raw_buffer);
+    });
+}
+
+void PassthroughTrackSource::OnFrameCaptured(rtc::scoped_refptr<V4L2FrameBuffer> raw_buffer) {
+    const int64_t timestamp_us = rtc::TimeMicros();
+    const int64_t translated_timestamp_us =
+        timestamp_aligner.TranslateTimestamp(timestamp_us, rtc::TimeMicros());
+
+    OnFrame(webrtc::VideoFrame::Builder()
+                .set_video_frame_buffer(raw_buffer)
+                .set_rotation(webrtc::kVideoRotation_0)
+                .set_timestamp_us(translated_timestamp_us)
+                .build());
+}
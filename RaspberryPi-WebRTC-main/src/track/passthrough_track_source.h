@@ -0,0 +1,20 @@
+#ifndef PASSTHROUGH_TRACK_SOURCE_H_
+#define PASSTHROUGH_TRACK_SOURCE_H_
+
+#include "track/scale_track_source.h"
+
+/* Hands the camera's h264 access units to the encoder as they are. Every frame is delivered and
+ * nothing is adapted, a skipped access unit would break the references of the following ones. */
+class PassthroughTrackSource : public ScaleTrackSource {
+  public:
+    static rtc::scoped_refptr<PassthroughTrackSource>
+    Create(std::shared_ptr<VideoCapturer> capturer);
+    PassthroughTrackSource(std::shared_ptr<VideoCapturer> capturer);
+    ~PassthroughTrackSource();
+    void StartTrack() override;
+
+  private:
+    void OnFrameCaptured(rtc::scoped_refptr<V4L2FrameBuffer> raw_buffer);
+};
+
+#endif
@@ -21,18 +21,25 @@ ScaleTrackSource::ScaleTrackSource(std::shared_ptr<VideoCapturer> capturer)
       width(capturer->width()),
       height(capturer->height()) {}
 
-ScaleTrackSource::~ScaleTrackSource() {
-    // todo: tell capture unsubscribe observer.
-}
+ScaleTrackSource::~ScaleTrackSource() { observer.reset(); }
 
 void ScaleTrackSource::StartTrack() {
-    auto observer = capturer->AsFrameBufferObservable();
-    observer->Subscribe([this](rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame_buffer) {
-        OnFrameCaptured(frame_buffer);
-    });
+    // scaling and format conversion run on the observer's thread, only the newest frame is kept.
+    Observable<rtc::scoped_refptr<V4L2FrameBuffer>>::Options options;
+    options.queue_size = 1;
+    options.retain = [](rtc::scoped_refptr<V4L2FrameBuffer> &frame_buffer) {
+        frame_buffer->CopyBufferData();
+    };
+
+    observer = capturer->AsFrameBufferObservable();
+    observer->Subscribe(
+        [this](rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+            OnFrameCaptured(frame_buffer);
+        },
+        options);
 }
 
-void ScaleTrackSource::OnFrameCaptured(rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame_buffer) {
+void ScaleTrackSource::OnFrameCaptured(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
     const int64_t timestamp_us = rtc::TimeMicros();
     const int64_t translated_timestamp_us =
         timestamp_aligner.TranslateTimestamp(timestamp_us, rtc::TimeMicros());
@@ -52,7 +59,8 @@ void ScaleTrackSource::OnFrameCaptured(rtc::scoped_refptr<webrtc::VideoFrameBuff
         int dst_stride = std::ceil((double)adapted_width / kBufferAlignment) * kBufferAlignment;
         auto i420_buffer = webrtc::I420Buffer::Create(adapted_width, adapted_height, dst_stride,
                                                       dst_stride / 2, dst_stride / 2);
-        i420_buffer->ScaleFrom(*frame_buffer->ToI420());
+        // a mjpeg source is already decoded close to the adapted size.
+        i420_buffer->ScaleFrom(*frame_buffer->ToI420(adapted_width, adapted_height));
         dst_buffer = i420_buffer;
     }
 
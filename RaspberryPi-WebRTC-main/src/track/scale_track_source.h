@@ -22,10 +22,11 @@ class ScaleTrackSource : public rtc::AdaptedVideoTrackSource {
     int width;
     int height;
     std::shared_ptr<VideoCapturer> capturer;
+    std::shared_ptr<Observable<rtc::scoped_refptr<V4L2FrameBuffer>>> observer;
     rtc::TimestampAligner timestamp_aligner;
 
   private:
-    void OnFrameCaptured(rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame_buffer);
+    void OnFrameCaptured(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer);
 };
 
 #endif
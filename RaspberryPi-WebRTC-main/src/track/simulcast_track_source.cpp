@@ -0,0 +1,174 @@
+#include "track/simulcast_track_source.h"
+
+#include <algorithm>
+
+#include "common/logging.h"
+#include "common/v4l2_frame_buffer.h"
+
+const int MAX_LAYERS = 3;
+
+rtc::scoped_refptr<SimulcastTrackSource>
+SimulcastTrackSource::Create(std::shared_ptr<VideoCapturer> capturer, int num_layers) {
+    auto obj = rtc::make_ref_counted<SimulcastTrackSource>(std::move(capturer), num_layers);
+    obj->StartTrack();
+    return obj;
+}
+
+SimulcastTrackSource::SimulcastTrackSource(std::shared_ptr<VideoCapturer> capturer,
+                                           int num_layers)
+    : ScaleTrackSource(capturer),
+      hw_accel_(capturer->config().hw_accel),
+      is_dma_src_(capturer->is_dma_capture()) {
+    num_layers = std::clamp(num_layers, 1, MAX_LAYERS);
+    for (int i = 0; i < num_layers; i++) {
+        // keep the sizes even for the 4:2:0 chroma planes.
+        layers_.push_back({(width >> i) & ~1, (height >> i) & ~1, nullptr});
+    }
+}
+
+SimulcastTrackSource::~SimulcastTrackSource() {
+    observer.reset();
+    layers_.clear();
+}
+
+void SimulcastTrackSource::StartTrack() {
+    if (hw_accel_) {
+        for (int i = 1; i < static_cast<int>(layers_.size()); i++) {
+            layers_[i].scaler = V4L2Scaler::Create(width, height, layers_[i].width,
+                                                   layers_[i].height, is_dma_src_, true);
+        }
+    }
+
+    observer = capturer->AsFrameBufferObservable();
+    if (hw_accel_) {
+        // decoded buffers are re-queued right after Next() returns, so hand them over inline.
+        observer->Subscribe([this](rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+            OnFrameCaptured(frame_buffer);
+        });
+        return;
+    }
+
+    Observable<rtc::scoped_refptr<V4L2FrameBuffer>>::Options options;
+    options.queue_size = 1;
+    options.retain = [](rtc::scoped_refptr<V4L2FrameBuffer> &frame_buffer) {
+        frame_buffer->CopyBufferData();
+    };
+    observer->Subscribe(
+        [this](rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+            OnFrameCaptured(frame_buffer);
+        },
+        options);
+}
+
+void SimulcastTrackSource::AddOrUpdateSink(rtc::VideoSinkInterface<webrtc::VideoFrame> *sink,
+                                           const rtc::VideoSinkWants &wants) {
+    int layer = SelectLayer(wants);
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    auto it = std::find_if(sinks_.begin(), sinks_.end(), [sink](const Sink &s) {
+        return s.sink == sink;
+    });
+    if (it == sinks_.end()) {
+        sinks_.push_back({sink, layer});
+    } else if (it->layer != layer) {
+        it->layer = layer;
+    } else {
+        return;
+    }
+    DEBUG_PRINT("Sink(%p) receives layer %d (%dx%d)", sink, layer, layers_[layer].width,
+                layers_[layer].height);
+}
+
+void SimulcastTrackSource::RemoveSink(rtc::VideoSinkInterface<webrtc::VideoFrame> *sink) {
+    std::unique_lock<std::mutex> lock(sinks_mutex_);
+    sinks_.erase(std::remove_if(sinks_.begin(), sinks_.end(),
+                                [sink](const Sink &s) {
+                                    return s.sink == sink;
+                                }),
+                 sinks_.end());
+
+    // the sink may still be in a delivery that copied the list before, unless it is ours.
+    auto self = std::this_thread::get_id();
+    delivered_.wait(lock, [this, self]() {
+        return delivering_threads_.empty() ||
+               std::find(delivering_threads_.begin(), delivering_threads_.end(), self) !=
+                   delivering_threads_.end();
+    });
+}
+
+int SimulcastTrackSource::SelectLayer(const rtc::VideoSinkWants &wants) const {
+    for (int i = 0; i < static_cast<int>(layers_.size()); i++) {
+        if (layers_[i].width * layers_[i].height <= wants.max_pixel_count) {
+            return i;
+        }
+    }
+    return layers_.size() - 1;
+}
+
+bool SimulcastTrackSource::IsLayerWatched(int layer) {
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    return std::any_of(sinks_.begin(), sinks_.end(), [layer](const Sink &s) {
+        return s.layer == layer;
+    });
+}
+
+void SimulcastTrackSource::OnFrameCaptured(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+    const int64_t timestamp_us = rtc::TimeMicros();
+    const int64_t translated_timestamp_us =
+        timestamp_aligner.TranslateTimestamp(timestamp_us, rtc::TimeMicros());
+
+    for (int i = 0; i < static_cast<int>(layers_.size()); i++) {
+        if (!IsLayerWatched(i)) {
+            continue;
+        }
+
+        if (i == 0) {
+            OnLayerFrame(i, frame_buffer, translated_timestamp_us);
+        } else if (layers_[i].scaler) {
+            V4L2Buffer decoded_buffer = frame_buffer->GetRawBuffer();
+            layers_[i].scaler->EmplaceBuffer(
+                decoded_buffer,
+                [this, i, frame_buffer, translated_timestamp_us](V4L2Buffer scaled_buffer) {
+                    OnLayerFrame(i,
+                                 V4L2FrameBuffer::Create(layers_[i].width, layers_[i].height,
+                                                         scaled_buffer, V4L2_PIX_FMT_YUV420),
+                                 translated_timestamp_us);
+                });
+        } else {
+            OnLayerFrame(i, frame_buffer->ToI420(layers_[i].width, layers_[i].height),
+                         translated_timestamp_us);
+        }
+    }
+}
+
+void SimulcastTrackSource::OnLayerFrame(int layer,
+                                        rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame_buffer,
+                                        int64_t timestamp_us) {
+    auto frame = webrtc::VideoFrame::Builder()
+                     .set_video_frame_buffer(frame_buffer)
+                     .set_rotation(webrtc::kVideoRotation_0)
+                     .set_timestamp_us(timestamp_us)
+                     .build();
+
+    // sinks run without the lock, so one may add or remove sinks and a slow one does not hold up
+    // the other layers.
+    std::vector<rtc::VideoSinkInterface<webrtc::VideoFrame> *> sinks;
+    auto self = std::this_thread::get_id();
+    {
+        std::lock_guard<std::mutex> lock(sinks_mutex_);
+        for (auto &sink : sinks_) {
+            if (sink.layer == layer) {
+                sinks.push_back(sink.sink);
+            }
+        }
+        delivering_threads_.push_back(self);
+    }
+    for (auto sink : sinks) {
+        sink->OnFrame(frame);
+    }
+    {
+        std::lock_guard<std::mutex> lock(sinks_mutex_);
+        delivering_threads_.erase(
+            std::find(delivering_threads_.begin(), delivering_threads_.end(), self));
+    }
+    delivered_.notify_all();
+}
@@ -0,0 +1,56 @@
+#ifndef SIMULCAST_TRACK_SOURCE_H_
+#define SIMULCAST_TRACK_SOURCE_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "codecs/v4l2/v4l2_scaler.h"
+#include "track/scale_track_source.h"
+
+/* Serves several resolutions of one capture, each half the size of the previous one. Every sink
+ * gets the largest layer its own VideoSinkWants allow, so a congested peer steps down alone
+ * instead of the whole source adapting to the worst link. A layer is scaled once per frame, however
+ * many peers watch it, and layers nobody watches are skipped. */
+class SimulcastTrackSource : public ScaleTrackSource {
+  public:
+    static rtc::scoped_refptr<SimulcastTrackSource> Create(std::shared_ptr<VideoCapturer> capturer,
+                                                           int num_layers);
+    SimulcastTrackSource(std::shared_ptr<VideoCapturer> capturer, int num_layers);
+    ~SimulcastTrackSource();
+    void StartTrack() override;
+
+    void AddOrUpdateSink(rtc::VideoSinkInterface<webrtc::VideoFrame> *sink,
+                         const rtc::VideoSinkWants &wants) override;
+    void RemoveSink(rtc::VideoSinkInterface<webrtc::VideoFrame> *sink) override;
+
+  private:
+    struct Layer {
+        int width;
+        int height;
+        std::unique_ptr<V4L2Scaler> scaler;
+    };
+
+    struct Sink {
+        rtc::VideoSinkInterface<webrtc::VideoFrame> *sink;
+        int layer;
+    };
+
+    bool hw_accel_;
+    bool is_dma_src_;
+    std::vector<Layer> layers_;
+    std::mutex sinks_mutex_;
+    std::vector<Sink> sinks_;
+    std::condition_variable delivered_;
+    // layers are scaled on their own threads, so several deliveries can run at once.
+    std::vector<std::thread::id> delivering_threads_;
+
+    int SelectLayer(const rtc::VideoSinkWants &wants) const;
+    bool IsLayerWatched(int layer);
+    void OnFrameCaptured(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer);
+    void OnLayerFrame(int layer, rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame_buffer,
+                      int64_t timestamp_us);
+};
+
+#endif
@@ -22,25 +22,28 @@ V4L2DmaTrackSource::V4L2DmaTrackSource(std::shared_ptr<VideoCapturer> capturer)
       config_width_(capturer->width()),
       config_height_(capturer->height()) {}
 
-V4L2DmaTrackSource::~V4L2DmaTrackSource() { scaler.reset(); }
+V4L2DmaTrackSource::~V4L2DmaTrackSource() {
+    observer.reset();
+    scaler.reset();
+}
 
 void V4L2DmaTrackSource::StartTrack() {
-    auto observer = capturer->AsFrameBufferObservable();
+    // decoded buffers are re-queued right after Next() returns, so hand them to the scaler inline.
+    observer = capturer->AsFrameBufferObservable();
     observer->Subscribe([this](rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
-        OnFrameCaptured(frame_buffer->GetRawBuffer());
+        OnFrameCaptured(frame_buffer);
     });
 }
 
-void V4L2DmaTrackSource::OnFrameCaptured(V4L2Buffer decoded_buffer) {
+void V4L2DmaTrackSource::OnFrameCaptured(rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
     const int64_t timestamp_us = rtc::TimeMicros();
     const int64_t translated_timestamp_us =
         timestamp_aligner.TranslateTimestamp(timestamp_us, rtc::TimeMicros());
 
     if (capturer->config().fixed_resolution) {
-        auto dst_buffer = V4L2FrameBuffer::Create(config_width_, config_height_, decoded_buffer,
-                                                  V4L2_PIX_FMT_YUV420);
+        // a leased camera buffer stays with the frame until the encoder has read it.
         OnFrame(webrtc::VideoFrame::Builder()
-                    .set_video_frame_buffer(dst_buffer)
+                    .set_video_frame_buffer(frame_buffer)
                     .set_rotation(webrtc::kVideoRotation_0)
                     .set_timestamp_us(translated_timestamp_us)
                     .build());
@@ -58,8 +61,11 @@ void V4L2DmaTrackSource::OnFrameCaptured(V4L2Buffer decoded_buffer) {
                 V4L2Scaler::Create(width, height, config_width_, config_height_, is_dma_src_, true);
         }
 
+        V4L2Buffer decoded_buffer = frame_buffer->GetRawBuffer();
+        // holding the source frame keeps a dma camera buffer from being re-queued while scaled.
         scaler->EmplaceBuffer(
-            decoded_buffer, [this, translated_timestamp_us](V4L2Buffer scaled_buffer) {
+            decoded_buffer,
+            [this, frame_buffer, translated_timestamp_us](V4L2Buffer scaled_buffer) {
                 auto dst_buffer = V4L2FrameBuffer::Create(config_width_, config_height_,
                                                           scaled_buffer, V4L2_PIX_FMT_YUV420);
 
@@ -0,0 +1,180 @@
+#include "common/utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <api/video/i420_buffer.h>
+#include <jpeglib.h>
+#include <third_party/libyuv/include/libyuv.h>
+
+using Clock = std::chrono::steady_clock;
+
+const int kRounds = 20;
+const int kQuality = 90;
+// 642 is not a multiple of the 16 px mcu, it goes through the scratch lines.
+const int kResolutions[][2] = {{640, 480}, {642, 362}, {1280, 720}, {1920, 1080}};
+const double kMaxMeanError = 2.0;
+const int kMaxError = 24;
+
+// The previous snapshot path: rgb conversion of a full frame, then libjpeg scanline by scanline.
+static unsigned long RgbJpeg(const webrtc::I420BufferInterface &i420_buffer, int quality) {
+    int width = i420_buffer.width();
+    int height = i420_buffer.height();
+
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    uint8_t *data = nullptr;
+    unsigned long size = 0;
+    jpeg_mem_dest(&cinfo, &data, &size);
+
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_EXT_BGR;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+
+    uint8_t *rgb_data = (uint8_t *)malloc(width * height * 3);
+    libyuv::I420ToRGB24(i420_buffer.DataY(), i420_buffer.StrideY(), i420_buffer.DataU(),
+                        i420_buffer.StrideU(), i420_buffer.DataV(), i420_buffer.StrideV(),
+                        rgb_data, width * 3, width, height);
+
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row_pointer = &rgb_data[cinfo.next_scanline * width * 3];
+        jpeg_write_scanlines(&cinfo, &row_pointer, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    free(rgb_data);
+    free(data);
+    return size;
+}
+
+struct PlaneError {
+    long sum = 0;
+    long count = 0;
+    int max = 0;
+
+    void Add(int expected, int actual) {
+        int diff = std::abs(expected - actual);
+        sum += diff;
+        count++;
+        max = std::max(max, diff);
+    }
+    double Mean() const { return count ? (double)sum / count : 0; }
+};
+
+// Decodes `jpeg` back to ycbcr and compares it with the planes it was encoded from. Chroma is
+// decoded without smoothing, so every 2x2 block repeats the sample it was made of.
+static bool RoundTrip(const webrtc::I420BufferInterface &i420_buffer, const Buffer &jpeg) {
+    int width = i420_buffer.width();
+    int height = i420_buffer.height();
+
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (uint8_t *)jpeg.start.get(), jpeg.length);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_YCbCr;
+    cinfo.do_fancy_upsampling = FALSE;
+    jpeg_start_decompress(&cinfo);
+
+    if ((int)cinfo.output_width != width || (int)cinfo.output_height != height) {
+        printf("size mismatch: %dx%d decoded as %dx%d\n", width, height, cinfo.output_width,
+               cinfo.output_height);
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    std::vector<uint8_t> ycbcr(width * height * 3);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row_pointer = &ycbcr[cinfo.output_scanline * width * 3];
+        jpeg_read_scanlines(&cinfo, &row_pointer, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    PlaneError y_error, u_error, v_error;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const uint8_t *pixel = &ycbcr[(y * width + x) * 3];
+            y_error.Add(i420_buffer.DataY()[y * i420_buffer.StrideY() + x], pixel[0]);
+            if (x % 2 || y % 2) {
+                continue;
+            }
+            int uv_x = x / 2;
+            int uv_y = y / 2;
+            u_error.Add(i420_buffer.DataU()[uv_y * i420_buffer.StrideU() + uv_x], pixel[1]);
+            v_error.Add(i420_buffer.DataV()[uv_y * i420_buffer.StrideV() + uv_x], pixel[2]);
+        }
+    }
+
+    bool ok = true;
+    const char *names[] = {"y", "u", "v"};
+    const PlaneError *errors[] = {&y_error, &u_error, &v_error};
+    for (int i = 0; i < 3; i++) {
+        bool plane_ok = errors[i]->Mean() <= kMaxMeanError && errors[i]->max <= kMaxError;
+        printf("  %dx%d %s plane: mean error %.2f, max error %d %s\n", width, height, names[i],
+               errors[i]->Mean(), errors[i]->max, plane_ok ? "ok" : "FAILED");
+        ok &= plane_ok;
+    }
+    return ok;
+}
+
+template <typename Encode> static void Measure(const char *name, int width, Encode encode) {
+    unsigned long size = encode();
+    auto start = Clock::now();
+    for (int i = 0; i < kRounds; i++) {
+        encode();
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / kRounds;
+    printf("%-12s %5d  %8.2f ms  %8lu bytes\n", name, width, ms, size);
+}
+
+int main(int argc, char *argv[]) {
+    bool ok = true;
+    printf("%-12s %5s  %11s  %14s\n", "path", "width", "time", "size");
+    for (auto &resolution : kResolutions) {
+        int width = resolution[0];
+        int height = resolution[1];
+        // padded strides like the ones the scale track hands out, so a stride mixed up with the
+        // width shows as a sheared image in the round trip.
+        int stride_y = (width + 63) / 64 * 64 + 64;
+        int stride_uv = stride_y / 2;
+        auto i420_buffer = webrtc::I420Buffer::Create(width, height, stride_y, stride_uv, stride_uv);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                // smooth content, the jpeg error stays far below a misplaced row.
+                i420_buffer->MutableDataY()[y * stride_y + x] =
+                    16 + 110 * x / width + 110 * y / height;
+            }
+        }
+        int chroma_width = (width + 1) / 2;
+        int chroma_height = (height + 1) / 2;
+        for (int y = 0; y < chroma_height; y++) {
+            for (int x = 0; x < chroma_width; x++) {
+                i420_buffer->MutableDataU()[y * stride_uv + x] = 64 + 128 * x / chroma_width;
+                i420_buffer->MutableDataV()[y * stride_uv + x] = 64 + 128 * y / chroma_height;
+            }
+        }
+
+        Measure("rgb", width, [&]() {
+            return RgbJpeg(*i420_buffer, kQuality);
+        });
+        Measure("raw yuv", width, [&]() {
+            return Utils::ConvertYuvToJpeg(*i420_buffer, kQuality).length;
+        });
+        ok &= RoundTrip(*i420_buffer, Utils::ConvertYuvToJpeg(*i420_buffer, kQuality));
+    }
+
+    printf("%s\n", ok ? "round trip passed" : "round trip FAILED");
+    return ok ? 0 : 1;
+}
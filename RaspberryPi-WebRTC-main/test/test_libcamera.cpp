@@ -33,7 +33,8 @@ int main(int argc, char *argv[]) {
     auto capturer = LibcameraCapturer::Create(args);
 
     auto observer = capturer->AsRawBufferObservable();
-    observer->Subscribe([&](V4L2Buffer buffer) {
+    observer->Subscribe([&](rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+        auto buffer = frame_buffer->GetRawBuffer();
         if (i < images_nb) {
             WriteImage(buffer.start, buffer.length, ++i);
         } else {
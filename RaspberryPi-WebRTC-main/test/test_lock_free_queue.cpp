@@ -0,0 +1,134 @@
+#include "common/lock_free_queue.h"
+#include "common/thread_safe_queue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Stands in for a frame: a ref-counted handle that is costly to copy.
+using Frame = std::shared_ptr<int>;
+
+const int kThroughputItems = 2000000;
+const int kFrames = 300;
+const int kFps = 30;
+
+static double ElapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+template <typename Push, typename Pop> static void Throughput(const char *name, Push push, Pop pop) {
+    auto start = Clock::now();
+    std::thread consumer([&]() {
+        for (int received = 0; received < kThroughputItems;) {
+            if (pop()) {
+                received++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    auto frame = std::make_shared<int>(0);
+    for (int i = 0; i < kThroughputItems; i++) {
+        while (!push(frame)) {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    printf("%-24s %8.1f ns/item\n", name, ElapsedNs(start) / kThroughputItems);
+}
+
+/* Frames are pushed at the camera rate, the consumer either polls like the recorders do or
+ * blocks on the queue. Reports the delay between push and the consumer seeing the frame. */
+template <typename Push, typename Wait>
+static void Handoff(const char *name, Push push, Wait wait) {
+    std::vector<double> latencies(kFrames);
+    std::thread consumer([&]() {
+        for (int i = 0; i < kFrames; i++) {
+            Clock::time_point pushed = wait();
+            latencies[i] = std::chrono::duration<double, std::micro>(Clock::now() - pushed).count();
+        }
+    });
+    for (int i = 0; i < kFrames; i++) {
+        std::this_thread::sleep_for(std::chrono::microseconds(1000000 / kFps));
+        push(Clock::now());
+    }
+    consumer.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    printf("%-24s p50 %8.1f us  p99 %8.1f us  max %8.1f us\n", name, latencies[kFrames / 2],
+           latencies[kFrames * 99 / 100], latencies.back());
+}
+
+int main(int argc, char *argv[]) {
+    printf("== throughput, one producer and one consumer\n");
+    {
+        ThreadSafeQueue<Frame> queue;
+        Throughput(
+            "ThreadSafeQueue",
+            [&](const Frame &frame) {
+                queue.push(frame);
+                return true;
+            },
+            [&]() {
+                return queue.pop().has_value();
+            });
+    }
+    {
+        SpscQueue<Frame> queue(64);
+        Throughput(
+            "SpscQueue",
+            [&](const Frame &frame) {
+                return queue.push(frame);
+            },
+            [&]() {
+                return queue.pop().has_value();
+            });
+    }
+    {
+        MpmcQueue<Frame> queue(64);
+        Throughput(
+            "MpmcQueue",
+            [&](const Frame &frame) {
+                return queue.push(frame);
+            },
+            [&]() {
+                return queue.pop().has_value();
+            });
+    }
+
+    printf("== handoff at %d fps\n", kFps);
+    {
+        ThreadSafeQueue<Clock::time_point> queue;
+        Handoff(
+            "ThreadSafeQueue + 20ms",
+            [&](Clock::time_point t) {
+                queue.push(t);
+            },
+            [&]() {
+                while (true) {
+                    if (auto item = queue.pop()) {
+                        return item.value();
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                }
+            });
+    }
+    {
+        BlockingQueue<Clock::time_point, SpscQueue<Clock::time_point>> queue(8);
+        Handoff(
+            "BlockingQueue (futex)",
+            [&](Clock::time_point t) {
+                queue.push(t);
+            },
+            [&]() {
+                return queue.wait_pop().value();
+            });
+    }
+
+    return 0;
+}
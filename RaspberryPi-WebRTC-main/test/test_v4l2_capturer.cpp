@@ -36,7 +36,8 @@ int main(int argc, char *argv[]) {
 
     auto capturer = V4L2Capturer::Create(args);
     auto observer = capturer->AsRawBufferObservable();
-    observer->Subscribe([&](V4L2Buffer buffer) {
+    observer->Subscribe([&](rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+        auto buffer = frame_buffer->GetRawBuffer();
         if (i < images_nb) {
             WriteImage(buffer, ++i);
         } else {
@@ -32,7 +32,8 @@ int main(int argc, char *argv[]) {
     auto decoder = V4L2Decoder::Create(args.width, args.height, capturer->format(), false);
 
     auto observer = capturer->AsRawBufferObservable();
-    observer->Subscribe([&](V4L2Buffer buffer) {
+    observer->Subscribe([&](rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+        auto buffer = frame_buffer->GetRawBuffer();
         printf("Camera buffer: %u\n", buffer.length);
         decoder->EmplaceBuffer(buffer, [&](V4L2Buffer decoded_buffer) {
             if (is_finished) {
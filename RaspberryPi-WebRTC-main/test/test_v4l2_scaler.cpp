@@ -35,7 +35,8 @@ int main(int argc, char *argv[]) {
 
     auto capturer = V4L2Capturer::Create(args);
     auto observer = capturer->AsRawBufferObservable();
-    observer->Subscribe([&](V4L2Buffer buffer) {
+    observer->Subscribe([&](rtc::scoped_refptr<V4L2FrameBuffer> frame_buffer) {
+        auto buffer = frame_buffer->GetRawBuffer();
         scaler->EmplaceBuffer(buffer, [&](V4L2Buffer scaled_buffer) {
             if (is_finished) {
                 return;